@@ -0,0 +1,9 @@
+#ifndef EVENTLOOPMANAGER_CACHELINE_H
+#define EVENTLOOPMANAGER_CACHELINE_H
+
+#include <cstddef>
+
+// 缓存行大小，用于把多线程频繁写入的字段隔开，避免伪共享（false sharing）
+inline constexpr std::size_t CACHE_LINE_SIZE = 64;
+
+#endif //EVENTLOOPMANAGER_CACHELINE_H
@@ -4,35 +4,503 @@
 #include <queue>
 #include <mutex>
 #include <condition_variable>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <functional>
+#include <stdexcept>
 #include <string>
-#include <iostream>
+#include <string_view>
+#include <ostream>
+#include <deque>
+#include <optional>
+#include <vector>
+#include "Coroutine.h"
+#include "Logger.h"
+#include "Metrics.h"
 #include "ThreadSafeBlockingQueue.h"
+#include "ThreadSafeLockFreeQueue.h"
+#include "ThreadSafePriorityLaneQueue.h"
+#include "ThreadSafeSpscQueue.h"
+
+// 通道的并发模式
+enum class ChannelMode {
+    MPMC,   // 任意数量的发送者和接收者
+    SPSC    // 恰好一个发送线程和一个接收线程，使用 wait-free 的 SPSC 环形队列
+};
+
+// 有界通道满时 send 的处理方式
+enum class BackpressurePolicy {
+    Block,      // 阻塞发送者直到有空位
+    DropOldest, // 丢弃队列中最旧的数据，为新数据腾出位置
+    DropNewest, // 丢弃本次发送的数据
+    FailFast    // 不入队，返回 SendStatus::Full，数据仍归调用方所有
+};
+
+enum class SendStatus {
+    Ok,
+    DroppedOldest, // 已入队，但挤掉了队列中最旧的数据
+    Dropped,       // 按 DropNewest 策略丢弃了本次数据
+    Full           // 按 FailFast 策略拒绝了本次数据
+};
+
+// 水位回调的参数是通道名和触发时的队列长度
+using WatermarkCallback = std::function<void(const std::string &, size_t)>;
+
+struct ChannelConfig {
+    size_t capacity = 0;  // 0 表示无界
+    ChannelMode mode = ChannelMode::MPMC;
+    BackpressurePolicy policy = BackpressurePolicy::Block;
+    // 队列长度达到 highWatermark 时调用 onHighWater，之后回落到 lowWatermark 以下时调用 onLowWater；
+    // highWatermark 为 0 表示不监控水位
+    size_t highWatermark = 0;
+    size_t lowWatermark = 0;
+    WatermarkCallback onHighWater;
+    WatermarkCallback onLowWater;
+    // 为 true 时每个优先级一条子队列，按 priorityWeights 加权轮询出队；capacity 按子队列计算
+    bool priorityLanes = false;
+    PriorityWeights priorityWeights = DEFAULT_PRIORITY_WEIGHTS;
+};
+
+// 带数据类型的通道名。通过 ChannelKey 订阅和发布时，监听器参数和数据的类型在编译期检查
+template<typename T>
+struct ChannelKey {
+    using ValueType = T;
+    std::string_view name;
+};
+
+// 通道计数器的快照
+struct ChannelStats {
+    uint64_t sent = 0;
+    uint64_t received = 0;
+    uint64_t droppedNewest = 0;
+    uint64_t droppedOldest = 0;
+    uint64_t rejected = 0;
+    std::chrono::nanoseconds blockedTime{0};
+};
 
 template<typename T>
 class Channel {
 private:
     std::string name;
     std::unique_ptr<ThreadSafeQueueInterface<T>> queue;
+    // 启用优先级子队列时指向 queue，否则为空，发送时忽略优先级
+    ThreadSafePriorityLaneQueue<T> *priorityQueue = nullptr;
+    BackpressurePolicy policy = BackpressurePolicy::Block;
+    size_t highWatermark = 0;
+    size_t lowWatermark = 0;
+    WatermarkCallback onHighWater;
+    WatermarkCallback onLowWater;
+    // SPSC 通道只允许接收线程出队，不支持 receiveAsync()：发送端和 close() 会替挂起的协程出队
+    bool singleConsumer = false;
+    std::atomic<bool> aboveHighWater{false};
+
+    std::atomic<uint64_t> sentCount{0};
+    std::atomic<uint64_t> receivedCount{0};
+    std::atomic<uint64_t> droppedNewestCount{0};
+    std::atomic<uint64_t> droppedOldestCount{0};
+    std::atomic<uint64_t> rejectedCount{0};
+    std::atomic<int64_t> blockedNanos{0};
+
+    // 挂起在 receiveAsync() 上的协程，按挂起顺序分配数据
+    struct AsyncReceiver {
+        std::coroutine_handle<> handle;
+        ThreadPool *pool = nullptr;
+        std::optional<T> value;
+    };
+    std::mutex asyncMutex;
+    std::deque<AsyncReceiver *> asyncReceivers;
+    // 发送端先检查这个计数，没有挂起的协程时不加锁
+    std::atomic<size_t> asyncWaiting{0};
+    // close() 之后 receiveAsync() 不再挂起，由 asyncMutex 保护写入
+    std::atomic<bool> closed{false};
 
 public:
+    // co_await channel.receiveAsync() 得到下一条数据；通道为空时挂起协程而不阻塞线程，
+    // 有数据到达后在 pool 上恢复（默认是 Manager 的线程池）。通道已关闭且取空时得到 std::nullopt
+    class ReceiveAwaiter {
+    public:
+        ReceiveAwaiter(Channel &channel, ThreadPool *pool) : channel(channel) {
+            receiver.pool = pool;
+        }
+
+        bool await_ready() {
+            receiver.value = channel.tryReceive();
+            return receiver.value.has_value();
+        }
+
+        bool await_suspend(std::coroutine_handle<> handle) {
+            receiver.handle = handle;
+            return channel.suspendReceiver(&receiver);
+        }
+
+        std::optional<T> await_resume() {
+            return std::move(receiver.value);
+        }
+
+    private:
+        Channel &channel;
+        AsyncReceiver receiver;
+    };
+
     // Constructors must now initialize the queue pointer with an instance of a class that implements ThreadSafeQueueInterface
-    Channel() : name("Unnamed"), queue(std::make_unique<ThreadSafeBlockingQueue<T>>()) {}
+    Channel() : name("Unnamed"), queue(std::make_unique<ThreadSafeBlockingQueue<T>>()) {
+        registerMetrics();
+    }
 
-    Channel(const std::string &name) : name(name), queue(std::make_unique<ThreadSafeBlockingQueue<T>>()) {}
+    Channel(const std::string &name) : name(name), queue(std::make_unique<ThreadSafeBlockingQueue<T>>()) {
+        registerMetrics();
+    }
+
+    // 有界通道：使用固定容量的无锁环形队列，队列满时 send 阻塞
+    Channel(const std::string &name, size_t capacity, ChannelMode mode = ChannelMode::MPMC)
+            : name(name), queue(makeBoundedQueue(capacity, mode)), singleConsumer(mode == ChannelMode::SPSC) {
+        registerMetrics();
+    }
+
+    // 按配置创建通道：容量、满时策略和水位回调
+    Channel(const std::string &name, const ChannelConfig &config)
+            : name(name),
+              queue(makeQueue(config)),
+              policy(config.policy),
+              highWatermark(config.highWatermark),
+              lowWatermark(config.lowWatermark),
+              onHighWater(config.onHighWater),
+              onLowWater(config.onLowWater),
+              singleConsumer(config.mode == ChannelMode::SPSC) {
+        // DropOldest 需要在发送端出队，违反 SPSC 的单消费者约定
+        if (config.mode == ChannelMode::SPSC && config.policy == BackpressurePolicy::DropOldest) {
+            throw std::invalid_argument("DropOldest policy is not supported on SPSC channel: " + name);
+        }
+        if (highWatermark != 0 && lowWatermark >= highWatermark) {
+            throw std::invalid_argument("lowWatermark must be below highWatermark on channel: " + name);
+        }
+        if (config.priorityLanes) {
+            priorityQueue = static_cast<ThreadSafePriorityLaneQueue<T> *>(queue.get());
+        }
+        registerMetrics();
+    }
+
+    // 使用调用方指定的队列实现
+    Channel(const std::string &name, std::unique_ptr<ThreadSafeQueueInterface<T>> queue)
+            : name(name), queue(std::move(queue)) {
+        registerMetrics();
+    }
+
+    SendStatus send(const T &data) {
+        T copy(data);
+        return send(std::move(copy));
+    }
+
+    SendStatus send(const T &data, Priority priority) {
+        T copy(data);
+        return send(std::move(copy), priority);
+    }
 
-    void send(const T &data) {
-        queue->push(data);
-        std::cout << "Sent data to channel: " << data << std::endl;
+    // 返回 Full 时 data 没有被移动，调用方可以稍后重试
+    SendStatus send(T &&data) {
+        return send(std::move(data), Priority::Normal);
+    }
+
+    // 按优先级发送；没有启用优先级子队列的通道忽略 priority
+    SendStatus send(T &&data, Priority priority) {
+        logSent(data);
+        SendStatus status = SendStatus::Ok;
+        if (!tryPushTo(std::move(data), priority)) {
+            status = sendFull(std::move(data), priority);
+        }
+        if (status == SendStatus::Ok || status == SendStatus::DroppedOldest) {
+            sentCount.fetch_add(1, std::memory_order_relaxed);
+            checkHighWater();
+            wakeAsyncReceivers();
+        }
+        return status;
+    }
+
+    // 在通道内直接构造数据，T 不需要可拷贝
+    template<typename... Args>
+    SendStatus emplace(Args &&... args) {
+        return send(T(std::forward<Args>(args)...));
     }
 
     T receive() {
         T data = queue->waitAndPop();
+        onReceived(1);
+        return data;
+    }
+
+    // SPSC 通道上抛出 std::logic_error
+    ReceiveAwaiter receiveAsync(ThreadPool *pool = coroutinePool().load(std::memory_order_acquire)) {
+        if (singleConsumer) {
+            throw std::logic_error("receiveAsync is not supported on SPSC channel: " + name);
+        }
+        return ReceiveAwaiter(*this, pool);
+    }
+
+    // 不等待，通道为空时返回 std::nullopt
+    std::optional<T> tryReceive() {
+        std::optional<T> data = queue->tryPop();
+        if (data) {
+            onReceived(1);
+        }
         return data;
     }
 
+    // 批量发送，后端一次同步即可放入整批数据；批量发送总是按 Block 策略等待空位
+    void sendBulk(std::span<const T> data) {
+        queue->pushBulk(data);
+        sentCount.fetch_add(data.size(), std::memory_order_relaxed);
+        checkHighWater();
+        wakeAsyncReceivers();
+    }
+
+    void sendBulk(std::vector<T> &&data) {
+        size_t count = data.size();
+        queue->pushBulk(std::move(data));
+        sentCount.fetch_add(count, std::memory_order_relaxed);
+        checkHighWater();
+        wakeAsyncReceivers();
+    }
+
+    // 一次唤醒最多取走 max 条数据，timeout 内没有数据则返回 0
+    size_t receiveBulk(std::vector<T> &out, size_t max, std::chrono::nanoseconds timeout) {
+        return onReceived(queue->waitAndPopBulk(out, max, timeout));
+    }
+
+    // 不等待，最多取走 max 条数据
+    size_t tryReceiveBulk(std::vector<T> &out, size_t max) {
+        return onReceived(queue->tryPopBulk(out, max));
+    }
+
+    // 不等待，取走通道中当前所有的数据
+    template<typename Container>
+    size_t drainTo(Container &out) {
+        return onReceived(queue->drainTo(out));
+    }
+
+    bool empty() const {
+        return queue->empty();
+    }
+
+    size_t size() const {
+        return queue->size();
+    }
+
+    // 关闭通道：挂起在 receiveAsync() 上的协程带着剩余的数据或 std::nullopt 恢复，之后的 receiveAsync()
+    // 取完剩余数据后不再挂起。只影响协程接收端，send 和同步的 receive 不受影响
+    void close() {
+        std::vector<AsyncReceiver *> ready;
+        {
+            std::lock_guard<std::mutex> lock(asyncMutex);
+            closed.store(true, std::memory_order_release);
+            while (!asyncReceivers.empty()) {
+                AsyncReceiver *receiver = asyncReceivers.front();
+                asyncReceivers.pop_front();
+                asyncWaiting.fetch_sub(1, std::memory_order_relaxed);
+                receiver->value = tryReceive();
+                ready.push_back(receiver);
+            }
+        }
+        for (AsyncReceiver *receiver: ready) {
+            resumeOn(receiver->pool, receiver->handle);
+        }
+    }
+
+    bool isClosed() const {
+        return closed.load(std::memory_order_acquire);
+    }
+
+    // 生产者可以据此自我节流：为 true 时暂停发送，直到消费者把队列拉回低水位以下
+    bool isAboveHighWater() const {
+        return aboveHighWater.load(std::memory_order_acquire);
+    }
+
+    ChannelStats stats() const {
+        ChannelStats snapshot;
+        snapshot.sent = sentCount.load(std::memory_order_relaxed);
+        snapshot.received = receivedCount.load(std::memory_order_relaxed);
+        snapshot.droppedNewest = droppedNewestCount.load(std::memory_order_relaxed);
+        snapshot.droppedOldest = droppedOldestCount.load(std::memory_order_relaxed);
+        snapshot.rejected = rejectedCount.load(std::memory_order_relaxed);
+        snapshot.blockedTime = std::chrono::nanoseconds(blockedNanos.load(std::memory_order_relaxed));
+        return snapshot;
+    }
+
     std::string getName() const {
         return name;
     }
+
+private:
+    // 登记挂起的协程。登记之后再检查一次队列，避免与并发的 send 互相错过；
+    // 返回 false 表示已经取到数据或通道已关闭，协程不挂起
+    bool suspendReceiver(AsyncReceiver *receiver) {
+        std::lock_guard<std::mutex> lock(asyncMutex);
+        if (closed.load(std::memory_order_relaxed)) {
+            receiver->value = tryReceive();
+            return false;
+        }
+        asyncWaiting.fetch_add(1, std::memory_order_seq_cst);
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        if (asyncReceivers.empty()) {
+            receiver->value = tryReceive();
+            if (receiver->value) {
+                asyncWaiting.fetch_sub(1, std::memory_order_relaxed);
+                return false;
+            }
+        }
+        asyncReceivers.push_back(receiver);
+        return true;
+    }
+
+    // 把队列中的数据按顺序交给挂起的协程，并在锁外把它们投递到线程池上恢复
+    void wakeAsyncReceivers() {
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        if (asyncWaiting.load(std::memory_order_seq_cst) == 0) {
+            return;
+        }
+        std::vector<AsyncReceiver *> ready;
+        {
+            std::lock_guard<std::mutex> lock(asyncMutex);
+            while (!asyncReceivers.empty()) {
+                std::optional<T> value = tryReceive();
+                if (!value) {
+                    break;
+                }
+                AsyncReceiver *receiver = asyncReceivers.front();
+                asyncReceivers.pop_front();
+                asyncWaiting.fetch_sub(1, std::memory_order_relaxed);
+                receiver->value = std::move(value);
+                ready.push_back(receiver);
+            }
+        }
+        // 协程恢复之后 receiver 所在的协程帧随时可能被释放，resumeOn 之后不能再访问它
+        for (AsyncReceiver *receiver: ready) {
+            resumeOn(receiver->pool, receiver->handle);
+        }
+    }
+
+    bool tryPushTo(T &&data, Priority priority) {
+        if (priorityQueue) {
+            return priorityQueue->tryPush(std::move(data), priority);
+        }
+        return queue->tryPush(std::move(data));
+    }
+
+    // 队列已满时按策略处理
+    SendStatus sendFull(T &&data, Priority priority) {
+        switch (policy) {
+            case BackpressurePolicy::Block: {
+                auto start = std::chrono::steady_clock::now();
+                if (priorityQueue) {
+                    priorityQueue->push(std::move(data), priority);
+                } else {
+                    queue->push(std::move(data));
+                }
+                auto blocked = std::chrono::steady_clock::now() - start;
+                blockedNanos.fetch_add(std::chrono::duration_cast<std::chrono::nanoseconds>(blocked).count(),
+                                       std::memory_order_relaxed);
+                return SendStatus::Ok;
+            }
+            case BackpressurePolicy::DropOldest: {
+                SendStatus status = SendStatus::Ok;
+                // 并发的接收者可能先一步腾出空位，所以每次出队后都重新尝试入队。
+                // 有优先级子队列时丢弃优先级最低的数据
+                do {
+                    if (priorityQueue ? priorityQueue->tryPopLowest() : queue->tryPop()) {
+                        droppedOldestCount.fetch_add(1, std::memory_order_relaxed);
+                        status = SendStatus::DroppedOldest;
+                    }
+                } while (!tryPushTo(std::move(data), priority));
+                return status;
+            }
+            case BackpressurePolicy::DropNewest:
+                droppedNewestCount.fetch_add(1, std::memory_order_relaxed);
+                return SendStatus::Dropped;
+            case BackpressurePolicy::FailFast:
+                rejectedCount.fetch_add(1, std::memory_order_relaxed);
+                return SendStatus::Full;
+        }
+        return SendStatus::Full;
+    }
+
+    void checkHighWater() {
+        if (highWatermark == 0 || aboveHighWater.load(std::memory_order_relaxed)) {
+            return;
+        }
+        size_t depth = queue->size();
+        if (depth >= highWatermark && !aboveHighWater.exchange(true, std::memory_order_acq_rel) && onHighWater) {
+            onHighWater(name, depth);
+        }
+    }
+
+    size_t onReceived(size_t count) {
+        if (count == 0) {
+            return 0;
+        }
+        receivedCount.fetch_add(count, std::memory_order_relaxed);
+        if (highWatermark != 0 && aboveHighWater.load(std::memory_order_relaxed)) {
+            size_t depth = queue->size();
+            if (depth <= lowWatermark && aboveHighWater.exchange(false, std::memory_order_acq_rel) && onLowWater) {
+                onLowWater(name, depth);
+            }
+        }
+        return count;
+    }
+
+    // 只有能输出到流的数据类型才记录内容；Trace 级别默认在编译期去掉
+    static void logSent(const T &data) {
+        if constexpr (requires(std::ostream &os) { os << data; }) {
+            LOG_TRACE("Sent data to channel: ", data);
+        }
+    }
+
+    static std::unique_ptr<ThreadSafeQueueInterface<T>> makeQueue(const ChannelConfig &config) {
+        if (config.priorityLanes) {
+            if (config.mode == ChannelMode::SPSC) {
+                throw std::invalid_argument("priority lanes are not supported on SPSC channels");
+            }
+            return std::make_unique<ThreadSafePriorityLaneQueue<T>>(config.capacity, config.priorityWeights);
+        }
+        if (config.capacity == 0) {
+            return std::make_unique<ThreadSafeBlockingQueue<T>>();
+        }
+        return makeBoundedQueue(config.capacity, config.mode);
+    }
+
+    static std::unique_ptr<ThreadSafeQueueInterface<T>> makeBoundedQueue(size_t capacity, ChannelMode mode) {
+        if (mode == ChannelMode::SPSC) {
+            return std::make_unique<ThreadSafeSpscQueue<T>>(capacity);
+        }
+        return std::make_unique<ThreadSafeLockFreeQueue<T>>(capacity);
+    }
+
+    // 队列深度和已有的计数器在采集时读取，发送和接收路径上没有额外开销
+    void registerMetrics() {
+        MetricsRegistry &registry = MetricsRegistry::instance();
+        std::string labels = MetricsRegistry::label("channel", name);
+        auto counter = [](const std::atomic<uint64_t> &count) {
+            return [&count] { return static_cast<double>(count.load(std::memory_order_relaxed)); };
+        };
+        metrics.push_back(registry.observe("eventloop_channel_depth", labels, MetricType::Gauge, [this] {
+            return static_cast<double>(queue->size());
+        }, "Items queued in the channel"));
+        metrics.push_back(registry.observe("eventloop_channel_sent_total", labels, MetricType::Counter,
+                                           counter(sentCount), "Items accepted by the channel"));
+        metrics.push_back(registry.observe("eventloop_channel_received_total", labels, MetricType::Counter,
+                                           counter(receivedCount), "Items taken from the channel"));
+        metrics.push_back(registry.observe("eventloop_channel_dropped_total", labels, MetricType::Counter, [this] {
+            return static_cast<double>(droppedNewestCount.load(std::memory_order_relaxed)
+                                       + droppedOldestCount.load(std::memory_order_relaxed)
+                                       + rejectedCount.load(std::memory_order_relaxed));
+        }, "Items dropped or rejected because the channel was full"));
+        metrics.push_back(registry.observe("eventloop_channel_blocked_seconds_total", labels, MetricType::Counter,
+                                           [this] {
+            return static_cast<double>(blockedNanos.load(std::memory_order_relaxed)) / 1e9;
+        }, "Time senders spent blocked on a full channel"));
+    }
+
+    // 声明在最后，最先注销，采集回调不会访问已经析构的成员
+    std::vector<MetricsRegistration> metrics;
 };
 
 #endif // CHANNEL_H
\ No newline at end of file
@@ -0,0 +1,12 @@
+#ifndef EVENTLOOPMANAGER_CHANNELKEYS_H
+#define EVENTLOOPMANAGER_CHANNELKEYS_H
+
+#include <string>
+#include "Channel.h"
+#include "SensorReading.h"
+
+// 应用中用到的通道，生产者和消费者通过同一个 key 发布和订阅，数据类型在编译期对齐
+// 传感器读数：Producer -> Consumer -> Kafka，只在 Kafka 出口处序列化为 JSON
+inline constexpr ChannelKey<SensorReading> DATA_CHANNEL{"DataChannel"};
+
+#endif //EVENTLOOPMANAGER_CHANNELKEYS_H
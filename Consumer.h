@@ -2,95 +2,232 @@
 #ifndef CONSUMER_H
 #define CONSUMER_H
 
-#include <iostream>
-#include <string>
+#include <atomic>
 #include <condition_variable>
 #include <mutex>
+#include <optional>
+#include <string>
+#include "Coroutine.h"
 #include "Process.h"
+#include "ChannelKeys.h"
 #include "Event.h"
+#include "Logger.h"
+#include "Manager.h"
 #include "kafkaProducer.h"
+#include "KafkaRoutingSink.h"
 #include "StatusChangeEvent.h"
 
 class Consumer {
 public:
-    std::condition_variable cv;
-    std::mutex mtx;
-    bool ready = false;
     std::string name_;
+    // 只在消费协程中访问，不需要加锁
     std::string currentStatus = "Pause";
     KafkaProducer kafkaProducer;
+    // 以传感器名为键：同一个传感器的读数落在同一个分区上；超出阈值的读数发往 topic_alerts
+    KafkaRoutingSink kafkaSink;
 
     Consumer(const std::string &name, const std::string &configFile, const std::string &topic) : name_(name),
                                                                                                  kafkaProducer(
                                                                                                          configFile,
-                                                                                                         topic) {}
+                                                                                                         topic),
+                                                                                                 kafkaSink(
+                                                                                                         kafkaProducer,
+                                                                                                         KafkaRoutingSink::bySensor(
+                                                                                                                 topic,
+                                                                                                                 topic + "_alerts")) {}
 
     void consumeData() {
         Process process(name_);
 
-        // 订阅通道，接收数据
-        /*
-         * 这段代码位于消费者类中，是用来订阅并接收来自 "DataChannel" 通道的数据。这里用到了 C++11 的 lambda 表达式作为回调函数，用于处理接收到的数据。下面我会分步解释这段代码的作用，然后讨论 currentStatus 变量的定义位置问题。
-            代码解释
-            订阅通道： process.subscribeChannel<std::string>("DataChannel", ...); 这一行订阅了名为 "DataChannel" 的通道。这意味着，当有数据发送到这个通道时，提供给 subscribeChannel 的回调函数会被调用。
-            回调函数： 回调函数通过 lambda 表达式定义，形式为 [this](const std::string& data) {...}。这个函数捕获了当前对象指针 this，以便在函数内部访问消费者的状态和成员变量。
-            等待条件满足： std::unique_lock<std::mutex> lock(this->mtx); this->cv.wait(lock, [this, &currentStatus]{ return this->ready || this->finished; });
-                这两行代码使用了条件变量来暂停线程的执行，直到 ready 变为 true 或者 finished 变为 true。这是为了控制何时处理接收到的数据：只有在准备好接收时（ready 为 true）或者准备结束（finished 为 true），线程才会继续执行。
-            处理接收到的数据： 如果 finished 标志被设置为 true，则函数立即返回，不再处理数据。这是一种清理或结束操作的标志。如果没有结束，则输出接收到的数据，并可能进行进一步的处理，如 JSON 解析。
-         */
-        std::cout << "thead: " << std::this_thread::get_id() << " " << name_ << " is consuming data." << std::endl;
-        process.subscribeChannel<std::string>("DataChannel", [this](const std::string &data) {
-            std::unique_lock<std::mutex> lock(this->mtx);
-            this->cv.wait(lock, [this] { return this->ready; });
-            // data 输出两位小数
-            std::cout << "Thread ID: " << std::this_thread::get_id() << " " << this->name_ << " receives data" << std::endl;
-
-            // 输出接收到的数据(示例用途)
-            // std::cout << this->name_ << " receives data: " << data << std::endl;
-
-            // 温湿度阈值控制，低于一定温度打开加热器，低于一定湿度打开加湿器
-            double temperatureThreshold = 10.0;
-            double humidityThreshold = 30.0;
-            if (data.find("temperature") != std::string::npos && data.find("humidity") != std::string::npos) {
-                rapidjson::Document doc;
-                doc.Parse(data.c_str());
-                double temperature = doc["temperature"].GetDouble();
-                double humidity = doc["humidity"].GetDouble();
-                if (temperature < temperatureThreshold) {
-                    std::cout << "Temperature is too low. Turn on the heater." << std::endl;
-                }
-                if (humidity < humidityThreshold) {
-                    std::cout << "Humidity is too low. Turn on the humidifier." << std::endl;
-                }
+        {
+            std::lock_guard<std::mutex> lock(lifecycleMutex);
+            if (stopping) {
+                return;
+            }
+            LOG_INFO(name_, " is consuming data.");
+            // 以广播方式订阅：多个 Consumer 订阅同一通道时共享同一份数据，不按订阅者拷贝。
+            // 监听器只把数据放进收件箱就返回，不阻塞分发线程；收件箱超过高水位时通过 DataChannel 的背压计数
+            // 让生产者节流（Producer 检查 isThrottled()），回落到低水位以下后恢复。
+            // 监听器只持有 mailbox 而不持有 this：取消订阅时已经在途的分发可能在 Consumer 销毁之后才调用它，
+            // 这时收件箱已经关闭，数据直接丢弃
+            dataListener = process.subscribeBroadcast(
+                    DATA_CHANNEL, [mailbox = mailbox](const std::shared_ptr<const SensorReading> &payload) {
+                        if (!mailbox->inbox.isClosed() &&
+                            mailbox->inbox.send(Delivery{payload}) == SendStatus::Dropped) {
+                            // 丢弃数也计入通道指标 eventloop_channel_dropped_total，这里每 1000 条提示一次
+                            uint64_t dropped = mailbox->dropped.fetch_add(1, std::memory_order_relaxed);
+                            if (dropped % 1000 == 0) {
+                                LOG_WARN(mailbox->consumerName, " inbox full, ", dropped + 1, " readings dropped");
+                            }
+                        }
+                    });
+
+            // 订阅状态变化事件，交给消费协程按顺序处理
+            statusListener = process.subscribeEvent(
+                    "StatusChangeEvent", [mailbox = mailbox](std::shared_ptr<Event> event) {
+                        if (auto statusChangeEvent = eventCast<StatusChangeEvent>(event)) {
+                            LOG_INFO(mailbox->consumerName, " receives status change event: ",
+                                     statusChangeEvent->status);
+                            mailbox->statusUpdates.send(StatusUpdate{statusChangeEvent->status});
+                        }
+                    });
+            started = true;
+        }
+
+        // 协程在第一个挂起点就返回，这里一直等到 stop() 之后协程退出，调用线程结束即表示消费已经完成
+        consumeLoop();
+        waitFinished();
+        LOG_INFO(name_, " consumes data finished.");
+    }
+
+    // 停止消费：取消订阅并关闭收件箱和状态通道。正在接收时先处理完收件箱中剩余的数据，
+    // 暂停中则丢弃剩余数据；之后协程退出，consumeData() 返回。可以在任意线程调用，可重复调用
+    void stop() {
+        {
+            std::lock_guard<std::mutex> lock(lifecycleMutex);
+            if (stopping) {
+                return;
             }
+            stopping = true;
+        }
+        if (dataListener != 0) {
+            Process::unsubscribeChannel(std::string(DATA_CHANNEL.name), dataListener);
+        }
+        if (statusListener != 0) {
+            Process::unsubscribeEvent("StatusChangeEvent", statusListener);
+        }
+        mailbox->inbox.close();
+        mailbox->statusUpdates.close();
+    }
+
+    // 协程持有 this，kafkaProducer 析构之前先停止并等待它退出
+    ~Consumer() {
+        stop();
+        waitFinished();
+        LOG_DEBUG("Consumer ", name_, " is destroyed.");
+    }
+
+private:
+    // 收件箱和状态通道的元素类型不能输出到流，Channel 不会逐条打印
+    struct Delivery {
+        std::shared_ptr<const SensorReading> payload;
+    };
 
+    struct StatusUpdate {
+        std::string status;
+    };
 
-            // 将收到的数据发送到Kafka
-            kafkaProducer.produce(data);
+    // 收件箱有界且不阻塞：消费者暂停或 Kafka 变慢时，积压到高水位就对 DataChannel 施加背压让生产者节流。
+    // 容量留出高水位之上的余量，容纳节流生效之前已经在途的读数；仍然放不下时丢弃新数据，不占住分发线程
+    static ChannelConfig inboxConfig(const ChannelHandle<SensorReading> &dataChannel) {
+        ChannelConfig config;
+        config.capacity = 4096;
+        config.policy = BackpressurePolicy::DropNewest;
+        config.highWatermark = 1024;
+        config.lowWatermark = 256;
+        config.onHighWater = [dataChannel](const std::string &name, size_t depth) {
+            LOG_WARN(name, " reached high watermark, depth ", depth, ", throttling producers");
+            dataChannel.applyBackpressure(true);
+        };
+        config.onLowWater = [dataChannel](const std::string &name, size_t depth) {
+            LOG_INFO(name, " back below low watermark, depth ", depth);
+            dataChannel.applyBackpressure(false);
+        };
+        return config;
+    }
+
+    // 收件箱和状态通道：由 Consumer 和两个监听器共同持有，监听器在 Consumer 销毁之后被调用也不会访问已释放的内存
+    struct Mailbox {
+        explicit Mailbox(const std::string &consumerName)
+                : consumerName(consumerName),
+                  inbox("ConsumerInbox", inboxConfig(Manager::getInstance().channel(DATA_CHANNEL))) {}
+
+        const std::string consumerName;
+        Channel<Delivery> inbox;
+        Channel<StatusUpdate> statusUpdates{"ConsumerStatus"};
+        std::atomic<uint64_t> dropped{0};
+    };
+
+    std::shared_ptr<Mailbox> mailbox = std::make_shared<Mailbox>(name_);
 
-            // 输出发送到Kafka的数据(示例用途)
-            // std::cout << this->name_ << " sent data to Kafka: " << data << std::endl;
-        });
+    // 以下由 lifecycleMutex 保护；监听器编号在 stop() 之前写入，之后只读
+    std::mutex lifecycleMutex;
+    std::condition_variable finishedCond;
+    bool started = false;
+    bool stopping = false;
+    bool finished = false;
+    ListenerId dataListener = 0;
+    ListenerId statusListener = 0;
 
-        // 订阅状态变化事件
-        process.subscribeEvent("StatusChangeEvent", [this](std::shared_ptr<Event> event) {
-            if (auto statusChangeEvent = std::dynamic_pointer_cast<StatusChangeEvent>(event)) {
-                std::unique_lock<std::mutex> lock(this->mtx);
-                currentStatus = statusChangeEvent->status;
-                if (currentStatus == "Receive") {
-                    this->ready = true;
-                } else {
-                    this->ready = false;
+    // 消费协程：等待数据和状态变化时挂起，不占用线程，恢复后在线程池上继续执行。
+    // 状态为 Pause 时数据留在收件箱中，收到 Receive 后按到达顺序继续处理；通道关闭后退出
+    Coroutine consumeLoop() {
+        Mailbox &box = *mailbox;
+        while (auto delivery = co_await box.inbox.receiveAsync()) {
+            // 先应用挂起期间到达的状态变化
+            while (auto update = box.statusUpdates.tryReceive()) {
+                currentStatus = update->status;
+            }
+            while (currentStatus != "Receive") {
+                auto update = co_await box.statusUpdates.receiveAsync();
+                if (!update) {
+                    break;
                 }
-                this->cv.notify_all();
-                std::cout << this->name_ << " receives status change event: " << currentStatus << std::endl;
+                currentStatus = update->status;
+            }
+            // 暂停期间被停止
+            if (currentStatus != "Receive") {
+                break;
             }
-        });
-        std::cout << "thead: " << std::this_thread::get_id() << " " << name_ <<  " consumes data finished." << std::endl;
+            handleData(delivery->payload);
+        }
+        finish();
     }
 
-    ~Consumer() {
-        std::cout << "Consumer " << name_ << " is destroyed." << std::endl;
+    // 在协程的最后调用：丢弃暂停期间没有处理的数据（收件箱回到低水位，撤销对生产者的背压），然后通知等待者。
+    // 通知之后 Consumer 随时可能被销毁，不能再访问成员
+    void finish() {
+        size_t discarded = 0;
+        while (mailbox->inbox.tryReceive()) {
+            ++discarded;
+        }
+        if (discarded != 0) {
+            LOG_WARN(name_, " discarded ", discarded, " unprocessed readings on stop");
+        }
+        std::lock_guard<std::mutex> lock(lifecycleMutex);
+        finished = true;
+        finishedCond.notify_all();
+    }
+
+    void waitFinished() {
+        std::unique_lock<std::mutex> lock(lifecycleMutex);
+        finishedCond.wait(lock, [this] { return finished || !started; });
+    }
+
+    void handleData(const std::shared_ptr<const SensorReading> &payload) {
+        const SensorReading &reading = *payload;
+        LOG_DEBUG(this->name_, " receives data from ", reading.sensorName());
+
+        // 温湿度阈值控制，低于一定温度打开加热器，低于一定湿度打开加湿器
+        double temperatureThreshold = 10.0;
+        double humidityThreshold = 30.0;
+        KafkaRouteFields fields;
+        fields.sensor = reading.sensorName();
+        fields.severity = "normal";
+        if (reading.temperature < temperatureThreshold) {
+            LOG_INFO("Temperature is too low. Turn on the heater.");
+            fields.severity = "alert";
+        }
+        if (reading.humidity < humidityThreshold) {
+            LOG_INFO("Humidity is too low. Turn on the humidifier.");
+            fields.severity = "alert";
+        }
+
+        // 只在这里序列化一次（复用本线程的 JsonContext），按传感器和告警级别路由到Kafka，由 librdkafka 复制
+        kafkaSink.send(fields, toJson(reading));
+
+        // 输出发送到Kafka的数据(示例用途)，Trace 级别默认在编译期去掉
+        LOG_TRACE(this->name_, " sent data to Kafka: ", reading.sensorName());
     }
 
 };
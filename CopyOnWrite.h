@@ -0,0 +1,78 @@
+#ifndef EVENTLOOPMANAGER_COPYONWRITE_H
+#define EVENTLOOPMANAGER_COPYONWRITE_H
+
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <type_traits>
+#include <utility>
+#include "CacheLine.h"
+
+/*
+ * 读多写少数据的写时复制容器（RCU 风格）。
+ *  - 读者 load() 得到当前版本的只读快照（shared_ptr），不获取任何锁，也不会等待写者；
+ *    快照在读者持有期间一直有效；
+ *  - 写者 update() 在写锁内复制当前版本、修改副本，再整体发布为新版本；
+ *    修改函数抛出异常时不发布，旧版本保持不变。
+ *
+ * 当前版本的 shared_ptr 放在堆上的 Holder 里，读者只需要在复制 shared_ptr 的几条指令期间
+ * 登记到 readers 计数上；写者换上新 Holder 之后等待 readers 归零再释放旧 Holder。
+ * 读者的登记窗口极短，所以写者几乎不会真正等待。
+ * （没有使用 std::atomic<std::shared_ptr>：libstdc++ 12 的实现内部是自旋锁，load 解锁时使用 relaxed 序。）
+ */
+template<typename T>
+class CopyOnWrite {
+public:
+    CopyOnWrite() : current(new Holder{std::make_shared<const T>()}) {}
+
+    CopyOnWrite(const CopyOnWrite &) = delete;
+    CopyOnWrite &operator=(const CopyOnWrite &) = delete;
+
+    ~CopyOnWrite() {
+        delete current.load(std::memory_order_relaxed);
+    }
+
+    std::shared_ptr<const T> load() const {
+        readers.fetch_add(1, std::memory_order_seq_cst);
+        std::shared_ptr<const T> snapshot = current.load(std::memory_order_seq_cst)->value;
+        readers.fetch_sub(1, std::memory_order_release);
+        return snapshot;
+    }
+
+    // mutate(T &) 修改新版本，返回值原样返回给调用方
+    template<typename F>
+    auto update(F &&mutate) -> std::invoke_result_t<F &, T &> {
+        std::lock_guard<std::mutex> lock(writeMutex);
+        auto next = std::make_shared<T>(*current.load(std::memory_order_relaxed)->value);
+        if constexpr (std::is_void_v<std::invoke_result_t<F &, T &>>) {
+            mutate(*next);
+            publish(std::move(next));
+        } else {
+            auto result = mutate(*next);
+            publish(std::move(next));
+            return result;
+        }
+    }
+
+private:
+    struct Holder {
+        std::shared_ptr<const T> value;
+    };
+
+    void publish(std::shared_ptr<const T> next) {
+        Holder *old = current.exchange(new Holder{std::move(next)}, std::memory_order_seq_cst);
+        // 仍在复制旧 shared_ptr 的读者退出之后才能释放旧 Holder；已经拿到的快照不受影响
+        while (readers.load(std::memory_order_seq_cst) != 0) {
+            std::this_thread::yield();
+        }
+        delete old;
+    }
+
+    std::atomic<Holder *> current;
+    alignas(CACHE_LINE_SIZE) mutable std::atomic<uint32_t> readers{0};
+    std::mutex writeMutex;
+};
+
+#endif //EVENTLOOPMANAGER_COPYONWRITE_H
@@ -0,0 +1,64 @@
+#ifndef EVENTLOOPMANAGER_COROUTINE_H
+#define EVENTLOOPMANAGER_COROUTINE_H
+
+#include <atomic>
+#include <coroutine>
+#include <exception>
+#include "Logger.h"
+#include "ThreadPool.h"
+
+/*
+ * C++20 协程支持。
+ * Coroutine 是分离式（fire-and-forget）的协程返回类型：调用协程函数后立即在当前线程上开始执行，
+ * 运行到第一个挂起点时返回调用方；协程结束时自动释放协程帧。协程体内未捕获的异常打印后丢弃。
+ *
+ * 挂起的协程由 awaitable（Channel::receiveAsync()、Manager::nextEvent<T>()、sleepFor()）在条件满足时
+ * 投递到线程池上恢复执行，等待期间不占用任何线程，所以可以同时存在成千上万个逻辑上的消费者和生产者。
+ *
+ * 协程帧中捕获的对象（例如成员协程中的 this）必须活得比协程长。
+ */
+class Coroutine {
+public:
+    struct promise_type {
+        Coroutine get_return_object() noexcept {
+            return {};
+        }
+
+        std::suspend_never initial_suspend() noexcept {
+            return {};
+        }
+
+        std::suspend_never final_suspend() noexcept {
+            return {};
+        }
+
+        void return_void() noexcept {}
+
+        void unhandled_exception() noexcept {
+            try {
+                throw;
+            } catch (const std::exception &e) {
+                LOG_ERROR("Coroutine threw: ", e.what());
+            } catch (...) {
+                LOG_ERROR("Coroutine threw an unknown exception");
+            }
+        }
+    };
+};
+
+// 协程默认在哪个线程池上恢复，Manager 构造时设置为它的线程池
+inline std::atomic<ThreadPool *> &coroutinePool() {
+    static std::atomic<ThreadPool *> pool{nullptr};
+    return pool;
+}
+
+// 把挂起的协程投递到线程池上恢复；没有线程池时直接在当前线程上恢复
+inline void resumeOn(ThreadPool *pool, std::coroutine_handle<> handle) {
+    if (pool) {
+        pool->post([handle] { handle.resume(); });
+    } else {
+        handle.resume();
+    }
+}
+
+#endif //EVENTLOOPMANAGER_COROUTINE_H
@@ -9,8 +9,39 @@
 
 class Event {
 public:
+    Event() noexcept = default;
+
     virtual ~Event() = default;
+
+    // 事件的具体类型标签，由 TypedEvent<Derived> 设置；直接构造的 Event 没有标签
+    const void *typeTag() const noexcept {
+        return tag;
+    }
+
+protected:
+    explicit Event(const void *tag) noexcept : tag(tag) {}
+
+private:
+    const void *tag = nullptr;
+};
+
+// 具体事件类型继承 TypedEvent<自身>，即可用 eventCast 做一次指针比较的类型转换，不需要 RTTI
+template<typename Derived>
+class TypedEvent : public Event {
+public:
+    static constexpr char TAG = 0;
+
+protected:
+    TypedEvent() noexcept : Event(&TAG) {}
 };
 
+// 替代 std::dynamic_pointer_cast：只匹配精确类型，不匹配时返回空指针
+template<typename T>
+std::shared_ptr<T> eventCast(const std::shared_ptr<Event> &event) noexcept {
+    if (event && event->typeTag() == &T::TAG) {
+        return std::static_pointer_cast<T>(event);
+    }
+    return nullptr;
+}
 
 #endif // EVENT_H
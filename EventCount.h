@@ -0,0 +1,106 @@
+#ifndef EVENTLOOPMANAGER_EVENTCOUNT_H
+#define EVENTLOOPMANAGER_EVENTCOUNT_H
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <mutex>
+
+/*
+ * EventCount 用于无锁队列的阻塞等待：只有在真正需要睡眠时才进入 atomic wait（Linux 上为 futex），
+ * 通知方在没有等待者时只需要一次原子读，不会产生系统调用。
+ *
+ * 使用方式（等待方）：
+ *   auto key = ec.prepareWait();
+ *   if (条件已满足) { ec.cancelWait(); } else { ec.wait(key); }
+ * 通知方在修改状态之后调用 notifyOne() / notifyAll()。
+ *
+ * std::atomic::wait 不支持超时，所以带截止时间的 waitUntil() 退回到 mutex + condition_variable，
+ * 只有存在这类等待者时通知方才会去碰这把锁。
+ */
+class EventCount {
+public:
+    using Key = uint32_t;
+
+    EventCount() = default;
+    EventCount(const EventCount &) = delete;
+    EventCount &operator=(const EventCount &) = delete;
+
+    // Registers the calling thread as a waiter. The condition must be re-checked after this call.
+    Key prepareWait() noexcept {
+        waiters.fetch_add(1, std::memory_order_seq_cst);
+        return epoch.load(std::memory_order_seq_cst);
+    }
+
+    // Undoes prepareWait() when the re-check found the condition already satisfied.
+    void cancelWait() noexcept {
+        waiters.fetch_sub(1, std::memory_order_seq_cst);
+    }
+
+    // Blocks until a notification newer than key has been issued.
+    void wait(Key key) noexcept {
+        epoch.wait(key, std::memory_order_seq_cst);
+        waiters.fetch_sub(1, std::memory_order_seq_cst);
+    }
+
+    // Like wait(), but gives up at deadline. Returns false on timeout.
+    template<typename Clock, typename Duration>
+    bool waitUntil(Key key, const std::chrono::time_point<Clock, Duration> &deadline) {
+        bool notified;
+        {
+            std::unique_lock<std::mutex> lock(timedMutex);
+            timedWaiters.fetch_add(1, std::memory_order_seq_cst);
+            notified = timedCond.wait_until(lock, deadline, [this, key] {
+                return epoch.load(std::memory_order_seq_cst) != key;
+            });
+            timedWaiters.fetch_sub(1, std::memory_order_seq_cst);
+        }
+        waiters.fetch_sub(1, std::memory_order_seq_cst);
+        return notified;
+    }
+
+    void notifyOne() noexcept {
+        if (hasWaiters()) {
+            epoch.fetch_add(1, std::memory_order_seq_cst);
+            epoch.notify_one();
+            notifyTimed(false);
+        }
+    }
+
+    void notifyAll() noexcept {
+        if (hasWaiters()) {
+            epoch.fetch_add(1, std::memory_order_seq_cst);
+            epoch.notify_all();
+            notifyTimed(true);
+        }
+    }
+
+private:
+    bool hasWaiters() const noexcept {
+        // 与等待方的 prepareWait() 配对，保证“先写数据再检查等待者”不会丢失唤醒
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        return waiters.load(std::memory_order_seq_cst) != 0;
+    }
+
+    void notifyTimed(bool all) noexcept {
+        if (timedWaiters.load(std::memory_order_seq_cst) == 0) {
+            return;
+        }
+        { std::lock_guard<std::mutex> lock(timedMutex); }
+        if (all) {
+            timedCond.notify_all();
+        } else {
+            timedCond.notify_one();
+        }
+    }
+
+    std::atomic<Key> epoch{0};
+    std::atomic<uint32_t> waiters{0};
+
+    std::atomic<uint32_t> timedWaiters{0};
+    std::mutex timedMutex;
+    std::condition_variable timedCond;
+};
+
+#endif //EVENTLOOPMANAGER_EVENTCOUNT_H
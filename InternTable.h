@@ -0,0 +1,114 @@
+#ifndef EVENTLOOPMANAGER_INTERNTABLE_H
+#define EVENTLOOPMANAGER_INTERNTABLE_H
+
+#include <atomic>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+#include "CopyOnWrite.h"
+
+/*
+ * 名字到编号的驻留表：每个名字在第一次注册时分配一个从 0 开始的编号，
+ * 之后通过编号访问条目只是一次数组下标加一次原子读，不再做字符串比较。
+ *  - find() / intern() 的查找路径读取写时复制的哈希表快照，支持 std::string_view，不分配内存；
+ *  - 条目由表持有，直到表析构才释放；replace() 换下来的旧条目同样保留，
+ *    所以 get() 返回的裸指针在表的生命周期内始终有效。
+ * 容量在构造时固定，超出时 intern() 抛出 std::length_error。
+ */
+template<typename Entry>
+class InternTable {
+public:
+    using Id = uint32_t;
+
+    explicit InternTable(size_t capacity)
+            : capacity(capacity), entries(new std::atomic<Entry *>[capacity]) {
+        for (size_t i = 0; i < capacity; ++i) {
+            entries[i].store(nullptr, std::memory_order_relaxed);
+        }
+    }
+
+    InternTable(const InternTable &) = delete;
+    InternTable &operator=(const InternTable &) = delete;
+
+    std::optional<Id> find(std::string_view name) const {
+        auto snapshot = ids.load();
+        auto it = snapshot->find(name);
+        if (it == snapshot->end()) {
+            return std::nullopt;
+        }
+        return it->second;
+    }
+
+    // 返回 name 的编号；name 第一次出现时调用 create() 构造它的条目
+    template<typename Create>
+    Id intern(std::string_view name, Create &&create) {
+        if (auto id = find(name)) {
+            return *id;
+        }
+        std::lock_guard<std::mutex> lock(writeMutex);
+        if (auto id = find(name)) {
+            return *id;
+        }
+        if (live.size() >= capacity) {
+            throw std::length_error("intern table is full, cannot register: " + std::string(name));
+        }
+        Id id = static_cast<Id>(live.size());
+        std::shared_ptr<Entry> entry = create();
+        live.push_back(entry);
+        names.emplace_back(name);
+        entries[id].store(entry.get(), std::memory_order_release);
+        // 条目就绪之后才让编号可见
+        ids.update([&](Map &current) { current.emplace(std::string(name), id); });
+        return id;
+    }
+
+    Entry *get(Id id) const {
+        return entries[id].load(std::memory_order_acquire);
+    }
+
+    // 替换编号对应的条目，返回旧条目
+    std::shared_ptr<Entry> replace(Id id, std::shared_ptr<Entry> entry) {
+        std::lock_guard<std::mutex> lock(writeMutex);
+        std::shared_ptr<Entry> old = std::move(live.at(id));
+        retired.push_back(old);
+        live[id] = entry;
+        entries[id].store(entry.get(), std::memory_order_release);
+        return old;
+    }
+
+    std::string nameOf(Id id) const {
+        std::lock_guard<std::mutex> lock(writeMutex);
+        return names.at(id);
+    }
+
+private:
+    // 透明哈希，允许用 std::string_view 直接查找
+    struct NameHash {
+        using is_transparent = void;
+
+        size_t operator()(std::string_view name) const noexcept {
+            return std::hash<std::string_view>{}(name);
+        }
+    };
+
+    using Map = std::unordered_map<std::string, Id, NameHash, std::equal_to<>>;
+
+    const size_t capacity;
+    std::unique_ptr<std::atomic<Entry *>[]> entries;
+    CopyOnWrite<Map> ids;
+
+    mutable std::mutex writeMutex;
+    // live[id] 是编号当前的条目，retired 保存被替换下来的条目
+    std::vector<std::shared_ptr<Entry>> live;
+    std::vector<std::shared_ptr<Entry>> retired;
+    std::vector<std::string> names;
+};
+
+#endif //EVENTLOOPMANAGER_INTERNTABLE_H
@@ -0,0 +1,40 @@
+#ifndef EVENTLOOPMANAGER_JSONCONTEXT_H
+#define EVENTLOOPMANAGER_JSONCONTEXT_H
+
+#include <string_view>
+#include <utility>
+#include "rapidjson/stringbuffer.h"
+#include "rapidjson/writer.h"
+
+/*
+ * 每个线程一个的 JSON 序列化上下文，在消息之间复用 StringBuffer 和 Writer，稳定状态下编码不分配内存：
+ * write() 清空（保留容量的）StringBuffer，Writer::Reset 后直接输出，结果以 string_view 返回。
+ * 返回的 string_view 属于当前线程的上下文，在本线程下一次 write() 之前有效。
+ */
+class JsonContext {
+public:
+    static JsonContext &local() {
+        thread_local JsonContext context;
+        return context;
+    }
+
+    JsonContext(const JsonContext &) = delete;
+    JsonContext &operator=(const JsonContext &) = delete;
+
+    // fn(writer) 输出一个完整的 JSON 值
+    template<typename Fn>
+    std::string_view write(Fn &&fn) {
+        buffer.Clear();
+        writer.Reset(buffer);
+        std::forward<Fn>(fn)(writer);
+        return {buffer.GetString(), buffer.GetSize()};
+    }
+
+private:
+    JsonContext() : writer(buffer) {}
+
+    rapidjson::StringBuffer buffer;
+    rapidjson::Writer<rapidjson::StringBuffer> writer;
+};
+
+#endif //EVENTLOOPMANAGER_JSONCONTEXT_H
@@ -0,0 +1,91 @@
+#ifndef EVENTLOOPMANAGER_KAFKAROUTINGSINK_H
+#define EVENTLOOPMANAGER_KAFKAROUTINGSINK_H
+
+#include <atomic>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <utility>
+#include "kafkaProducer.h"
+
+// 路由依据：从消息中取出的字段，为空表示消息中没有这个字段
+struct KafkaRouteFields {
+    std::string_view sensor;   // 传感器（生产者）名
+    std::string_view region;
+    std::string_view severity; // 例如 "normal"、"alert"
+};
+
+// 路由结果：目标主题和消息键，键为空表示不带键
+struct KafkaRoute {
+    std::string topic;
+    std::string key;
+};
+
+// 把路由结果写进 route；route 在同一个线程的消息之间复用，赋值时不会重新分配内存
+using KafkaRouter = std::function<void(const KafkaRouteFields &, KafkaRoute &route)>;
+
+/*
+ * 多主题路由的 Kafka 出口：按消息字段选择主题和键，再交给 KafkaProducer 发送。
+ * 主题句柄由 KafkaProducer 缓存，键决定分区：以传感器名为键时同一个传感器的读数保持在同一个分区上，
+ * 下游按分区消费时顺序不变。
+ */
+class KafkaRoutingSink {
+public:
+    KafkaRoutingSink(KafkaProducer &producer, KafkaRouter router) : producer(producer), router(std::move(router)) {}
+
+    // 返回 false 表示消息没有交给 librdkafka，见 KafkaProducer::produce
+    bool send(const KafkaRouteFields &fields, std::shared_ptr<const std::string> payload) {
+        KafkaRoute &route = localRoute();
+        router(fields, route);
+        return producer.produce(route.topic, route.key, std::move(payload));
+    }
+
+    // payload 由 librdkafka 复制，调用返回后即可复用（例如 JsonContext 的输出），路由和发送都不分配内存
+    bool send(const KafkaRouteFields &fields, std::string_view payload) {
+        KafkaRoute &route = localRoute();
+        router(fields, route);
+        return producer.produce(route.topic, route.key, payload);
+    }
+
+    // 以传感器名为键；severity 为 "alert" 且 alertTopic 非空时发往 alertTopic，否则发往 topic。
+    // region 非空时作为主题后缀，例如 topic.us-east
+    static KafkaRouter bySensor(std::string topic, std::string alertTopic = {}) {
+        return [topic = std::move(topic), alertTopic = std::move(alertTopic)](const KafkaRouteFields &fields,
+                                                                              KafkaRoute &route) {
+            route.topic.assign(fields.severity == "alert" && !alertTopic.empty() ? alertTopic : topic);
+            if (!fields.region.empty()) {
+                route.topic.append(".").append(fields.region);
+            }
+            route.key.assign(fields.sensor);
+        };
+    }
+
+    // 自定义分区器的示例：带键的消息按键的 FNV-1a 哈希取模，同一个键总在同一个分区上；
+    // 没有键的消息轮流发往各个分区，各分区负载均衡
+    static KafkaPartitioner hashPartitioner() {
+        auto next = std::make_shared<std::atomic<uint32_t>>(0);
+        return [next](std::string_view, std::string_view key, int32_t partitionCount) -> int32_t {
+            if (key.empty()) {
+                return static_cast<int32_t>(next->fetch_add(1, std::memory_order_relaxed) % partitionCount);
+            }
+            uint32_t hash = 2166136261u;
+            for (char c: key) {
+                hash = (hash ^ static_cast<uint8_t>(c)) * 16777619u;
+            }
+            return static_cast<int32_t>(hash % static_cast<uint32_t>(partitionCount));
+        };
+    }
+
+private:
+    static KafkaRoute &localRoute() {
+        thread_local KafkaRoute route;
+        return route;
+    }
+
+    KafkaProducer &producer;
+    KafkaRouter router;
+};
+
+#endif //EVENTLOOPMANAGER_KAFKAROUTINGSINK_H
@@ -0,0 +1,326 @@
+#ifndef EVENTLOOPMANAGER_LOGGER_H
+#define EVENTLOOPMANAGER_LOGGER_H
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <ctime>
+#include <memory>
+#include <mutex>
+#include <new>
+#include <sstream>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <tuple>
+#include <type_traits>
+#include <utility>
+#include <vector>
+#include "CacheLine.h"
+
+enum class LogLevel : uint8_t {
+    Trace,
+    Debug,
+    Info,
+    Warn,
+    Error,
+    Off
+};
+
+// 编译期日志级别（LogLevel 的数值）：低于它的 LOG_xxx 语句整条被编译掉，参数也不会求值。
+// 默认保留 Debug 及以上，运行期再用 Logger::setLevel() 过滤；-DEVENTLOOPMANAGER_LOG_LEVEL=0 打开 Trace
+#ifndef EVENTLOOPMANAGER_LOG_LEVEL
+#define EVENTLOOPMANAGER_LOG_LEVEL 1
+#endif
+
+/*
+ * 异步日志。
+ *  - 每个写日志的线程有自己的单生产者/单消费者环形缓冲区，写入是一次定长槽位的原地构造和一次 release 写，
+ *    没有锁、没有系统调用，也不格式化：参数按值保存在槽位里，由后台线程调用 operator<< 格式化（延迟格式化）；
+ *  - 后台写线程轮流取出各线程的记录，格式化后批量写到 stdout，空闲时每 FLUSH_INTERVAL 醒来一次；
+ *  - 缓冲区满时丢弃新记录并计数，写日志的线程永远不会被阻塞。
+ *
+ * 参数的保存方式：字符串字面量只保存指针；const char* / std::string_view 复制为 std::string（指向的内存可能
+ * 在格式化之前失效）；其他类型按值复制。参数总大小超过槽位时在写日志的线程上立即格式化。
+ * 不同线程的记录各自保持顺序，线程之间按后台线程取出的顺序输出，每条记录带有时间戳。
+ */
+class Logger {
+public:
+    static constexpr size_t RING_CAPACITY = 1024;
+    static constexpr size_t ARG_BYTES = 96;
+    static constexpr std::chrono::milliseconds FLUSH_INTERVAL{5};
+
+    static Logger &instance() {
+        static Logger logger;
+        return logger;
+    }
+
+    Logger(const Logger &) = delete;
+    Logger &operator=(const Logger &) = delete;
+
+    ~Logger() {
+        {
+            std::lock_guard<std::mutex> lock(writerMutex);
+            stopping = true;
+        }
+        writerCond.notify_all();
+        writer.join();
+    }
+
+    static void setLevel(LogLevel level) {
+        instance().runtimeLevel.store(level, std::memory_order_relaxed);
+    }
+
+    static bool enabled(LogLevel level) {
+        return level >= instance().runtimeLevel.load(std::memory_order_relaxed);
+    }
+
+    template<typename... Args>
+    static void log(LogLevel level, Args &&... args) {
+        instance().localRing().push(level, std::forward<Args>(args)...);
+    }
+
+    // 等待调用之前写入的日志全部输出
+    void flush() {
+        std::unique_lock<std::mutex> lock(writerMutex);
+        uint64_t target = ++flushRequested;
+        writerCond.notify_all();
+        flushedCond.wait(lock, [&] { return flushCompleted >= target || stopping; });
+    }
+
+    // 因缓冲区满而丢弃的记录数
+    uint64_t dropped() const {
+        uint64_t total = retiredDropped.load(std::memory_order_relaxed);
+        std::lock_guard<std::mutex> lock(ringsMutex);
+        for (auto &ring: rings) {
+            total += ring->droppedCount.load(std::memory_order_relaxed);
+        }
+        return total;
+    }
+
+private:
+    // 参数按值保存的方式，见类注释
+    template<typename T>
+    struct Stored {
+        using Decayed = std::decay_t<T>;
+        using Referenced = std::remove_reference_t<T>;
+        using type = std::conditional_t<std::is_array_v<Referenced> && std::is_const_v<Referenced>, Decayed,
+                std::conditional_t<std::is_same_v<Decayed, const char *> || std::is_same_v<Decayed, char *>
+                                   || std::is_same_v<Decayed, std::string_view>, std::string, Decayed>>;
+    };
+
+    struct Record {
+        // 格式化参数并析构它们
+        void (*format)(unsigned char *args, std::ostream &out) = nullptr;
+        int64_t timestampNanos = 0;
+        LogLevel level = LogLevel::Info;
+        alignas(std::max_align_t) unsigned char args[ARG_BYTES];
+    };
+
+    class Ring {
+    public:
+        explicit Ring(std::thread::id thread) : thread(thread), slots(new Record[RING_CAPACITY]) {}
+
+        // 后台线程停止后才写入的记录不再输出，只析构保存的参数
+        ~Ring() {
+            std::ostringstream discard;
+            drain([&](Record &record, std::thread::id) { record.format(record.args, discard); });
+        }
+
+        template<typename... Args>
+        void push(LogLevel level, Args &&... args) {
+            size_t t = tail.load(std::memory_order_relaxed);
+            if (t - cachedHead == RING_CAPACITY) {
+                cachedHead = head.load(std::memory_order_acquire);
+                if (t - cachedHead == RING_CAPACITY) {
+                    droppedCount.fetch_add(1, std::memory_order_relaxed);
+                    return;
+                }
+            }
+            Record &record = slots[t & (RING_CAPACITY - 1)];
+            record.level = level;
+            record.timestampNanos = std::chrono::duration_cast<std::chrono::nanoseconds>(
+                    std::chrono::system_clock::now().time_since_epoch()).count();
+            using Tuple = std::tuple<typename Stored<Args>::type...>;
+            if constexpr (sizeof(Tuple) <= ARG_BYTES && alignof(Tuple) <= alignof(std::max_align_t)) {
+                new(record.args) Tuple(std::forward<Args>(args)...);
+                record.format = &formatTuple<Tuple>;
+            } else {
+                // 参数太大，立即格式化成一个字符串再保存
+                std::ostringstream text;
+                (text << ... << args);
+                new(record.args) std::tuple<std::string>(text.str());
+                record.format = &formatTuple<std::tuple<std::string>>;
+            }
+            tail.store(t + 1, std::memory_order_release);
+        }
+
+        // 后台线程调用：依次处理已经写入的记录，返回处理的条数
+        template<typename Fn>
+        size_t drain(Fn &&fn) {
+            size_t h = head.load(std::memory_order_relaxed);
+            size_t t = tail.load(std::memory_order_acquire);
+            for (size_t i = h; i != t; ++i) {
+                fn(slots[i & (RING_CAPACITY - 1)], thread);
+            }
+            head.store(t, std::memory_order_release);
+            return t - h;
+        }
+
+        const std::thread::id thread;
+        std::atomic<uint64_t> droppedCount{0};
+        // 所属线程已经退出，取完剩余记录后移除
+        std::atomic<bool> retired{false};
+
+    private:
+        std::unique_ptr<Record[]> slots;
+        alignas(CACHE_LINE_SIZE) std::atomic<size_t> head{0};
+        alignas(CACHE_LINE_SIZE) std::atomic<size_t> tail{0};
+        size_t cachedHead = 0;
+    };
+
+    // 线程退出时把自己的缓冲区标记为退役，由后台线程取完剩余记录后释放
+    struct RingHolder {
+        std::shared_ptr<Ring> ring;
+
+        ~RingHolder() {
+            if (ring) {
+                ring->retired.store(true, std::memory_order_release);
+            }
+        }
+    };
+
+    template<typename Tuple>
+    static void formatTuple(unsigned char *args, std::ostream &out) {
+        Tuple *tuple = std::launder(reinterpret_cast<Tuple *>(args));
+        std::apply([&](const auto &... values) { (out << ... << values); }, *tuple);
+        tuple->~Tuple();
+    }
+
+    Logger() : writer([this] { writeLoop(); }) {}
+
+    Ring &localRing() {
+        thread_local RingHolder holder;
+        if (!holder.ring) {
+            holder.ring = std::make_shared<Ring>(std::this_thread::get_id());
+            std::lock_guard<std::mutex> lock(ringsMutex);
+            rings.push_back(holder.ring);
+        }
+        return *holder.ring;
+    }
+
+    static const char *levelName(LogLevel level) {
+        switch (level) {
+            case LogLevel::Trace:
+                return "TRACE";
+            case LogLevel::Debug:
+                return "DEBUG";
+            case LogLevel::Info:
+                return "INFO";
+            case LogLevel::Warn:
+                return "WARN";
+            case LogLevel::Error:
+                return "ERROR";
+            case LogLevel::Off:
+                break;
+        }
+        return "";
+    }
+
+    void writeRecord(Record &record, std::thread::id thread) {
+        std::time_t seconds = static_cast<std::time_t>(record.timestampNanos / 1000000000);
+        std::tm local{};
+        localtime_r(&seconds, &local);
+        char time[32];
+        size_t length = std::strftime(time, sizeof(time), "%H:%M:%S", &local);
+        std::snprintf(time + length, sizeof(time) - length, ".%06lld",
+                      static_cast<long long>(record.timestampNanos % 1000000000 / 1000));
+        text << time << ' ' << levelName(record.level) << " [" << thread << "] ";
+        record.format(record.args, text);
+        text << '\n';
+    }
+
+    // 取出所有缓冲区中的记录并写出，返回处理的条数
+    size_t drainAll() {
+        {
+            std::lock_guard<std::mutex> lock(ringsMutex);
+            snapshot = rings;
+        }
+        size_t count = 0;
+        for (auto &ring: snapshot) {
+            bool retired = ring->retired.load(std::memory_order_acquire);
+            count += ring->drain([this](Record &record, std::thread::id thread) { writeRecord(record, thread); });
+            if (retired) {
+                std::lock_guard<std::mutex> lock(ringsMutex);
+                retiredDropped.fetch_add(ring->droppedCount.load(std::memory_order_relaxed), std::memory_order_relaxed);
+                std::erase(rings, ring);
+            }
+        }
+        snapshot.clear();
+        std::string out = text.str();
+        if (!out.empty()) {
+            std::fwrite(out.data(), 1, out.size(), stdout);
+            std::fflush(stdout);
+            text.str(std::string());
+        }
+        return count;
+    }
+
+    void writeLoop() {
+        std::unique_lock<std::mutex> lock(writerMutex);
+        while (true) {
+            uint64_t flushTarget = flushRequested;
+            bool stop = stopping;
+            lock.unlock();
+            while (drainAll() != 0) {}
+            lock.lock();
+            flushCompleted = flushTarget;
+            flushedCond.notify_all();
+            if (stop) {
+                break;
+            }
+            writerCond.wait_for(lock, FLUSH_INTERVAL, [&] { return stopping || flushRequested != flushCompleted; });
+        }
+    }
+
+    std::atomic<LogLevel> runtimeLevel{LogLevel::Info};
+
+    mutable std::mutex ringsMutex;
+    std::vector<std::shared_ptr<Ring>> rings;
+    std::atomic<uint64_t> retiredDropped{0};
+
+    // 以下只在后台线程中使用
+    std::vector<std::shared_ptr<Ring>> snapshot;
+    std::ostringstream text;
+
+    std::mutex writerMutex;
+    std::condition_variable writerCond;
+    std::condition_variable flushedCond;
+    uint64_t flushRequested = 0;
+    uint64_t flushCompleted = 0;
+    bool stopping = false;
+
+    std::thread writer;
+};
+
+// 编译期低于 EVENTLOOPMANAGER_LOG_LEVEL 的语句整条消失；运行期低于 Logger::setLevel() 的语句只读一次原子变量
+#define EVENTLOOPMANAGER_LOG(level, ...)                                                         \
+    do {                                                                                         \
+        if constexpr (static_cast<int>(level) >= EVENTLOOPMANAGER_LOG_LEVEL) {                   \
+            if (Logger::enabled(level)) {                                                        \
+                Logger::log(level, __VA_ARGS__);                                                 \
+            }                                                                                    \
+        }                                                                                        \
+    } while (0)
+
+// 用法：LOG_INFO("channel ", name, " depth ", depth); 参数依次用 operator<< 拼接
+#define LOG_TRACE(...) EVENTLOOPMANAGER_LOG(LogLevel::Trace, __VA_ARGS__)
+#define LOG_DEBUG(...) EVENTLOOPMANAGER_LOG(LogLevel::Debug, __VA_ARGS__)
+#define LOG_INFO(...) EVENTLOOPMANAGER_LOG(LogLevel::Info, __VA_ARGS__)
+#define LOG_WARN(...) EVENTLOOPMANAGER_LOG(LogLevel::Warn, __VA_ARGS__)
+#define LOG_ERROR(...) EVENTLOOPMANAGER_LOG(LogLevel::Error, __VA_ARGS__)
+
+#endif //EVENTLOOPMANAGER_LOGGER_H
@@ -2,17 +2,34 @@
 #define MANAGER_H
 
 #include <string>
+#include <string_view>
 #include <map>
 #include <vector>
 #include <thread>
 #include <mutex>
+#include <condition_variable>
 #include <functional>
 #include <memory>
 #include <queue>
 #include <chrono>
-#include <any>
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <stdexcept>
+#include <type_traits>
 #include "Channel.h"
+#include "CopyOnWrite.h"
+#include "Coroutine.h"
+#include "Event.h"
+#include "InternTable.h"
+#include "Logger.h"
+#include "Metrics.h"
+#include "MetricsExporter.h"
+#include "Priority.h"
+#include "Reactor.h"
+#include "Strand.h"
 #include "ThreadPool.h"
+#include "TimerWheel.h"
 
 using namespace std::chrono;
 
@@ -23,166 +40,1107 @@ class Event;
 using EventHandler = std::function<void(std::shared_ptr<Event>)>;
 template<typename T>
 using ChannelHandler = std::function<void(T)>;
+// 广播监听器：所有订阅者共享同一份只读数据，订阅者再多也不拷贝
+template<typename T>
+using SharedChannelHandler = std::function<void(const std::shared_ptr<const T> &)>;
+// 订阅时返回的监听器编号，用于取消订阅
+using ListenerId = uint64_t;
+// 驻留后的事件类型编号和通道编号，由 Manager::eventType() / Manager::channel() 分配
+using EventTypeId = uint32_t;
+using ChannelId = uint32_t;
+// scheduleAfter() / scheduleEvery() 返回的定时器编号，用于 cancel()
+using TimerId = TimerWheel::TimerId;
+
+template<typename T>
+class ChannelHandle;
+
+template<typename T>
+class EventAwaiter;
+
+// Manager 的启动配置，在第一次调用 Manager::getInstance() 之前通过 Manager::configure() 设置
+struct ManagerConfig {
+    // 处理通道数据的线程池大小
+    size_t threadPoolThreads = 4;
+    ThreadPlacement threadPoolPlacement{PinningStrategy::None, {}, "pool"};
+    // Manager::strandFor() 使用的 strand 数量，按键哈希分配
+    size_t strands = 256;
+    // 分片（反应器）数量；0 表示不分片，带路由键的事件和通道数据按不带键的方式处理
+    size_t shards = 0;
+    // 分片默认依次绑定到各个 CPU
+    ThreadPlacement shardPlacement{PinningStrategy::Compact, {}, "shard"};
+    // 指标导出：默认不导出，指标仍然可以通过 MetricsRegistry::instance() 读取
+    MetricsExportConfig metrics;
+};
 
 class Manager {
 private:
-    Manager() : threadPool(std::make_unique<ThreadPool>(4)) {} // 假设线程池大小为4
+    explicit Manager(const ManagerConfig &config);
+
+    template<typename T>
+    friend class ChannelHandle;
+
+    template<typename Fn>
+    struct ListenerEntry {
+        ListenerId id;
+        Fn fn;
+    };
+
+    using EventListenerList = std::vector<ListenerEntry<EventHandler>>;
+    // 排队中的事件、发布时监听器列表的快照和发布时间（metricsNow()）
+    struct QueuedEvent {
+        std::shared_ptr<Event> event;
+        std::shared_ptr<const EventListenerList> handlers;
+        int64_t publishedNanos;
+    };
+    using EventBatch = std::vector<QueuedEvent>;
+
+    // 通道表中保存的类型擦除基类，typeTag 记录通道的数据类型，取出时据此检查类型
+    struct ChannelSlotBase {
+        const void *const typeTag;
+
+        explicit ChannelSlotBase(const void *typeTag) : typeTag(typeTag) {}
+
+        virtual ~ChannelSlotBase() = default;
+
+        virtual bool removeListener(ListenerId id) = 0;
+    };
+
+    // 每种数据类型一个唯一地址，作为类型标签，不依赖 RTTI
+    template<typename T>
+    static constexpr char typeTagOf = 0;
+
+    // 一条分发队列：数据先进入 channel，再由同一时刻唯一的分发任务按顺序交给监听器
+    template<typename T>
+    struct ChannelLane {
+        Channel<T> channel;
+        // 是否已经有分发任务在排队或运行，保证同一队列同时只有一个分发任务
+        std::atomic<bool> dispatchScheduled{false};
+        // 分发任务所在的分片；nullptr 表示在线程池上分发
+        Reactor *const reactor;
+
+        template<typename... Args>
+        explicit ChannelLane(Reactor *reactor, Args &&... args)
+                : channel(std::forward<Args>(args)...), reactor(reactor) {}
+    };
+
+    template<typename T>
+    struct ChannelListeners {
+        std::vector<ListenerEntry<std::function<void(T)>>> byValue;
+        std::vector<ListenerEntry<SharedChannelHandler<T>>> shared;
+    };
+
+    // 每个通道的数据先进入有界的 Channel<T>，再由线程池上的分发任务按顺序交给监听器；
+    // 监听器以 std::function<void(T)> 保存在通道自己的槽位里，分发时直接以 T 调用，不经过装箱。
+    // 分片模式下每个分片另有一条分发队列，带路由键的数据进入键所在分片的队列，在该分片的线程上分发
+    template<typename T>
+    struct ChannelSlot : ChannelSlotBase {
+        ChannelLane<T> lane;
+        std::vector<std::unique_ptr<ChannelLane<T>>> shardLanes;
+
+        // 写时复制：分发任务每批取一次快照，不加锁
+        CopyOnWrite<ChannelListeners<T>> listeners;
+        // 发布时无需取快照即可判断是否有监听器
+        std::atomic<size_t> listenerCount{0};
+        // 要求生产者暂停的下游数，见 ChannelHandle::applyBackpressure()；由 channelListenersMutex 保护写入
+        std::atomic<int> backpressure{0};
+        // 已经把 Channel<T>& 交给过调用方：替换槽位后这些引用会指向不再分发的旧通道，所以不允许再替换
+        std::atomic<bool> referenced{false};
+
+        void markReferenced() {
+            if (!referenced.load(std::memory_order_relaxed)) {
+                referenced.store(true, std::memory_order_relaxed);
+            }
+        }
 
-    std::map<std::string, std::shared_ptr<void>> channels;
+        // 各分片的队列使用相同的配置，名字为“通道名#分片编号”
+        template<typename... Args>
+        ChannelSlot(const std::vector<std::unique_ptr<Reactor>> &shards, const std::string &name, const Args &... args)
+                : ChannelSlotBase(&typeTagOf<T>), lane(nullptr, name, args...) {
+            for (auto &shard: shards) {
+                shardLanes.push_back(std::make_unique<ChannelLane<T>>(
+                        shard.get(), name + "#" + std::to_string(shard->index()), args...));
+            }
+        }
+
+        bool removeListener(ListenerId id) override {
+            bool removed = listeners.update([id](ChannelListeners<T> &current) {
+                return eraseListener(current.byValue, id) || eraseListener(current.shared, id);
+            });
+            if (removed) {
+                listenerCount.fetch_sub(1, std::memory_order_release);
+            }
+            return removed;
+        }
+    };
+
+    // 一个分发任务最多连续处理的消息数，之后重新投递，让其他通道的任务有机会执行
+    static constexpr size_t DISPATCH_BATCH = 64;
+
+    // 可注册的通道数和事件类型数上限
+    static constexpr size_t MAX_CHANNELS = 1024;
+    static constexpr size_t MAX_EVENT_TYPES = 1024;
+
+    // 通道和事件类型按名字驻留为编号，发布时按编号直接取槽位；
+    // 槽位在 Manager 的生命周期内不会释放，分发任务可以直接持有裸指针
+    InternTable<ChannelSlotBase> channels{MAX_CHANNELS};
+    // 通道监听器的增删、背压计数与 replaceSlot 互斥：重建通道时复制的状态不会漏掉并发的修改
+    std::mutex channelListenersMutex;
     std::map<std::string, std::shared_ptr<Process>> processes;
-    std::map<std::string, std::vector<EventHandler>> eventListeners;
-    std::map<std::string, std::vector<std::function<void(std::any)>>> channelListeners;
-    // event任务队列 eventTaskQueue
-    std::queue<std::pair<std::shared_ptr<Event>, EventHandler>> eventTaskQueue;
+    // 每个事件类型一份写时复制的监听器列表：发布路径只读取快照，不加锁；订阅和取消订阅发布新版本
+    InternTable<CopyOnWrite<EventListenerList>> eventTypes{MAX_EVENT_TYPES};
+    std::atomic<ListenerId> nextListenerId{1};
+    // event任务队列，每个优先级一条，由 eventMutex 保护；每个事件带上发布时监听器列表的快照。
+    // 事件循环每次把所有队列换出来处理，两块缓冲区交替使用，稳定状态下不再分配内存
+    std::array<EventBatch, PRIORITY_LEVELS> eventQueues;
+    // 有高优先级事件在排队：事件循环处理积压的普通事件时据此让高优先级事件插队
+    std::atomic<bool> highPriorityPending{false};
 
+    // 按键串行执行的 strand；声明在线程池之前，线程池先析构并执行完剩余任务
+    std::unique_ptr<StrandGroup> strands;
     // channel处理线程池
     std::unique_ptr<ThreadPool> threadPool;
+    // 分片模式下的反应器；声明在通道表和线程池之后，析构时最先停止
+    std::vector<std::unique_ptr<Reactor>> shards;
+
+    inline static ManagerConfig startupConfig;
+    inline static std::atomic<bool> instanceCreated{false};
 
     // event互斥锁
     std::mutex eventMutex;
+    // 有新事件或请求停止时唤醒事件循环
+    std::condition_variable eventCond;
+    bool stopRequested = false;
 
-    // channel互斥锁
-    std::mutex channelMutex;
+    // 定时器由 eventMutex 保护，在事件循环中推进，到期的回调在事件循环线程上执行
+    TimerWheel timers;
+    // 事件循环本轮睡眠到的时间；新定时器更早到期时置位 timersChanged 并唤醒事件循环
+    steady_clock::time_point loopWakeAt = steady_clock::time_point::max();
+    bool timersChanged = false;
 
     high_resolution_clock::time_point _start_time;
     high_resolution_clock::duration _elapsed;
 
+    // 指标：事件从发布到开始分发的延迟和分发的事件数；排队的事件数在采集时读取
+    LatencyHistogram &eventDispatchLatency;
+    MetricCounter &eventsDispatched;
+    MetricsRegistration eventQueueMetric;
+    // 最先析构：先停止导出线程
+    std::unique_ptr<MetricsExporter> metricsExporter;
+
 public:
     Manager(const Manager &) = delete;
 
     Manager &operator=(const Manager &) = delete;
 
+    ~Manager();
+
     static Manager &getInstance();
 
+    // 设置启动配置，必须在第一次调用 getInstance() 之前调用，否则抛出 std::logic_error
+    static void configure(const ManagerConfig &config);
+
     // 提供线程池访问接口
     ThreadPool &getThreadPool() {
         return *threadPool;
     }
 
-    void subscribeEvent(const std::string &eventType, const EventHandler &handler);
+    // 键所在的 strand：提交到同一个键的任务在线程池上按提交顺序逐个执行，不同的键并行执行。
+    // 监听器需要按传感器等维度保序地做后续处理时，把工作提交到 strandFor(key) 而不是直接提交到线程池
+    Strand &strandFor(std::string_view key) {
+        return strands->strandFor(key);
+    }
+
+    // 返回事件类型的编号，首次调用时注册；频繁发布的事件应当保存编号，按编号发布和订阅
+    EventTypeId eventType(std::string_view name);
+
+    ListenerId subscribeEvent(EventTypeId eventType, const EventHandler &handler);
+
+    ListenerId subscribeEvent(const std::string &eventType, const EventHandler &handler);
+
+    // 取消订阅。已经进入事件队列的事件仍会交给发布时的监听器
+    bool unsubscribeEvent(EventTypeId eventType, ListenerId id);
+
+    bool unsubscribeEvent(const std::string &eventType, ListenerId id);
+
+    // co_await manager.nextEvent<T>(type) 挂起协程，直到挂起之后发布的下一个该类型、且能 eventCast 为 T 的事件，
+    // 协程在线程池上恢复并得到这个事件。事件由事件循环分发，需要 run() 在运行
+    template<typename T>
+    EventAwaiter<T> nextEvent(EventTypeId eventType) {
+        return EventAwaiter<T>(*this, eventType);
+    }
+
+    template<typename T>
+    EventAwaiter<T> nextEvent(const std::string &eventType) {
+        return nextEvent<T>(this->eventType(eventType));
+    }
+
+    // 高优先级的事件先于已经排队的普通事件处理，事件循环正在处理积压的普通事件时也会插队。
+    // 每一轮事件循环都会处理完换出来的所有优先级的事件，低优先级的事件不会被饿死
+    void publishEvent(EventTypeId eventType, std::shared_ptr<Event> event, Priority priority = Priority::Normal);
+
+    void publishEvent(const std::string &eventType, std::shared_ptr<Event> event,
+                      Priority priority = Priority::Normal);
+
+    // 返回通道句柄，首次调用时以默认配置（无界）创建通道。
+    // 句柄保存通道编号，之后的发布和订阅是一次数组下标访问，不再按名字查找；
+    // 同名通道的数据类型必须一致，否则抛出 std::logic_error
+    template<typename T>
+    ChannelHandle<T> channel(std::string_view channelName);
+
+    template<typename T>
+    ChannelHandle<T> channel(const ChannelKey<T> &key) {
+        return channel<T>(key.name);
+    }
+
+    template<typename T>
+    ListenerId subscribeChannel(const std::string &channelName, std::function<void(T)> listener);
 
-    void publishEvent(const std::string &eventType, std::shared_ptr<Event> event);
+    // 通过 ChannelKey 订阅：监听器的参数类型在编译期与通道类型匹配
+    template<typename T>
+    ListenerId subscribeChannel(const ChannelKey<T> &key, std::type_identity_t<std::function<void(T)>> listener);
 
+    // 以广播方式订阅：每条消息只装箱一次为 shared_ptr<const T>，所有广播监听器读取同一份数据，
+    // 每条消息的开销不随订阅者数量增长；需要保留数据的监听器复制这个 shared_ptr 即可
     template<typename T>
-    void subscribeChannel(const std::string &channelName, std::function<void(T)> listener);
+    ListenerId subscribeBroadcast(const std::string &channelName, SharedChannelHandler<T> listener);
 
     template<typename T>
-    void publishToChannel(const std::string &channelName, T data);
+    ListenerId subscribeBroadcast(const ChannelKey<T> &key, std::type_identity_t<SharedChannelHandler<T>> listener);
 
+    // 取消按值或广播订阅。正在分发的一批消息仍可能交给该监听器
+    bool unsubscribeChannel(const std::string &channelName, ListenerId id);
+
+    // data 按值类别转发：传入右值时数据被移动进通道，T 可以是只能移动的类型
+    // 通道满时按通道的 BackpressurePolicy 处理；没有监听器时数据被丢弃并返回 SendStatus::Dropped。
+    // priority 只对启用了优先级子队列（ChannelConfig::priorityLanes）的通道生效
+    template<typename T>
+    SendStatus publishToChannel(const std::string &channelName, T &&data, Priority priority = Priority::Normal);
+
+    // 通过 ChannelKey 发布：data 必须能构造出通道的数据类型，否则编译失败
+    template<typename T, typename U>
+    SendStatus publishToChannel(const ChannelKey<T> &key, U &&data, Priority priority = Priority::Normal);
+
+    // 返回的引用在 Manager 的生命周期内有效；取过引用的通道不能再用 createChannel 重新创建
     template<typename T>
     Channel<T> &getOrCreateChannel(const std::string &channelName);
 
+    template<typename T>
+    Channel<T> &getOrCreateChannel(const ChannelKey<T> &key) {
+        return getOrCreateChannel<T>(std::string(key.name));
+    }
+
+    // 创建或重新创建通道，已经订阅的监听器和 ChannelHandle 保持有效。
+    // 通道对象的引用（getOrCreateChannel、ChannelHandle::get）被取过之后再调用抛出 std::logic_error
     template<typename T>
     void createChannel(const std::string &channelName);
 
+    // 创建容量为 capacity 的有界通道（无锁环形队列），单发送者/单接收者的链路可声明为 SPSC
+    template<typename T>
+    void createChannel(const std::string &channelName, size_t capacity, ChannelMode mode = ChannelMode::MPMC);
+
+    // 按配置创建通道：容量、满时策略和水位回调
+    template<typename T>
+    void createChannel(const std::string &channelName, const ChannelConfig &config);
+
+    template<typename T>
+    void createChannel(const ChannelKey<T> &key, const ChannelConfig &config) {
+        createChannel<T>(std::string(key.name), config);
+    }
+
+    // delay 之后在事件循环线程上执行一次 callback，可以在任意线程（包括定时器回调中）调用。
+    // 回调和事件处理函数共用事件循环线程，耗时的工作应当投递到线程池
+    TimerId scheduleAfter(steady_clock::duration delay, Task callback);
+
+    // 每隔 period 执行一次 callback，第一次在 period 之后；同一个定时器的回调不会并发执行
+    TimerId scheduleEvery(steady_clock::duration period, Task callback);
+
+    // 取消定时器，返回 false 表示定时器已经不存在。已经到期但尚未执行的回调不再执行
+    bool cancel(TimerId id);
+
+    // 分片数量，0 表示没有启用分片
+    size_t shardCount() const {
+        return shards.size();
+    }
+
+    Reactor &shard(size_t index) {
+        return *shards.at(index);
+    }
+
+    // 路由键所在的分片；同一个键总是落在同一个分片上。没有启用分片时抛出 std::logic_error
+    Reactor &shardFor(std::string_view key);
+
+    // 在路由键所在分片的线程上发布事件：同一个键的事件按发布顺序处理，处理函数在分片线程上执行。
+    // 没有启用分片时等同于不带键的 publishEvent()
+    void publishEvent(std::string_view key, EventTypeId eventType, std::shared_ptr<Event> event,
+                      Priority priority = Priority::Normal);
+
+    void publishEvent(std::string_view key, const std::string &eventType, std::shared_ptr<Event> event,
+                      Priority priority = Priority::Normal);
+
+    // 带路由键发布到通道：数据进入键所在分片的队列，在该分片的线程上按顺序分发
+    template<typename T, typename U>
+    SendStatus publishToChannel(const ChannelKey<T> &key, std::string_view routingKey, U &&data,
+                                Priority priority = Priority::Normal);
+
+    // 停止所有分片并等待线程退出，之后带路由键的发布抛出 std::runtime_error
+    void stopShards();
+
+    // 运行事件循环，直到 runtime 用完或 stop() 被调用；没有事件和到期的定时器时线程睡眠，不轮询
     void run(high_resolution_clock::duration runtime);
 
+    // 让正在运行的事件循环尽快返回，可以在任意线程调用
+    void stop();
+
+private:
+    TimerId scheduleTimer(steady_clock::time_point when, steady_clock::duration period, Task callback);
+
+    template<typename T>
+    ChannelId internChannel(std::string_view channelName);
+
+    template<typename T>
+    ChannelSlot<T> *slotOf(ChannelId id) {
+        return static_cast<ChannelSlot<T> *>(channels.get(id));
+    }
+
+    template<typename T>
+    ListenerId subscribeSlot(ChannelId id, std::function<void(T)> listener);
+
+    template<typename T>
+    ListenerId subscribeBroadcastSlot(ChannelId id, SharedChannelHandler<T> listener);
+
+    bool removeChannelListener(ChannelId id, ListenerId listenerId);
+
+    template<typename T, typename U>
+    SendStatus publishSlot(ChannelId id, U &&data, Priority priority);
+
+    template<typename T, typename U>
+    SendStatus publishSlot(ChannelId id, std::string_view routingKey, U &&data, Priority priority);
+
+    template<typename T, typename U>
+    SendStatus publishLane(ChannelSlot<T> *slot, ChannelLane<T> *lane, U &&data, Priority priority);
+
+    static void dispatchEvent(const std::shared_ptr<Event> &event, const EventListenerList &handlers);
+
+    // 记录发布到分发的延迟后分发
+    void dispatchEvent(const std::shared_ptr<Event> &event, const EventListenerList &handlers,
+                       int64_t publishedNanos);
+
+    // 在处理积压事件的间隙先处理新到达的高优先级事件
+    void runHighPriorityEvents(EventBatch &urgent);
+
+    size_t shardIndexOf(std::string_view key) const;
+
+    template<typename T>
+    void checkMoveOnlyListener(ChannelId id, const ChannelListeners<T> &listeners, bool broadcast);
+
+    template<typename Entries>
+    static bool eraseListener(Entries &entries, ListenerId id);
+
+    template<typename T, typename... Args>
+    void replaceSlot(const std::string &channelName, Args &&... args);
+
+    template<typename T>
+    void scheduleDispatch(ChannelSlot<T> *slot, ChannelLane<T> *lane);
+
+    template<typename T>
+    void postDispatch(ChannelSlot<T> *slot, ChannelLane<T> *lane);
+
+    template<typename T>
+    void dispatchChannel(ChannelSlot<T> *slot, ChannelLane<T> *lane);
+
 };
 
+// 通道句柄：通过 Manager::channel<T>() 获取一次，之后按编号直接访问通道。
+// 句柄很小，可以按值复制；通道被 createChannel 重新创建后，句柄自动指向新的通道
+template<typename T>
+class ChannelHandle {
+public:
+    ChannelHandle() = default;
+
+    // data 必须能构造出 T，否则编译失败
+    template<typename U>
+    SendStatus publish(U &&data, Priority priority = Priority::Normal) const {
+        static_assert(std::is_constructible_v<T, U &&>, "data type does not match the channel's data type");
+        return manager->publishSlot<T>(channelId, std::forward<U>(data), priority);
+    }
+
+    // 带路由键发布，见 Manager::publishToChannel(key, routingKey, data)
+    template<typename U>
+    SendStatus publish(std::string_view routingKey, U &&data, Priority priority = Priority::Normal) const {
+        static_assert(std::is_constructible_v<T, U &&>, "data type does not match the channel's data type");
+        return manager->publishSlot<T>(channelId, routingKey, std::forward<U>(data), priority);
+    }
+
+    ListenerId subscribe(std::function<void(T)> listener) const {
+        return manager->subscribeSlot<T>(channelId, std::move(listener));
+    }
+
+    ListenerId subscribeBroadcast(SharedChannelHandler<T> listener) const {
+        return manager->subscribeBroadcastSlot<T>(channelId, std::move(listener));
+    }
+
+    bool unsubscribe(ListenerId id) const {
+        return manager->removeChannelListener(channelId, id);
+    }
+
+    // 当前的通道对象（不带路由键的队列），用于查看计数器、水位等。取过之后通道不能再被 createChannel 重新创建
+    Channel<T> &get() const {
+        auto *slot = manager->slotOf<T>(channelId);
+        slot->markReferenced();
+        return slot->lane.channel;
+    }
+
+    // 路由键所在的队列；没有启用分片时与 get() 相同
+    Channel<T> &get(std::string_view routingKey) const {
+        auto *slot = manager->slotOf<T>(channelId);
+        slot->markReferenced();
+        if (slot->shardLanes.empty()) {
+            return slot->lane.channel;
+        }
+        return slot->shardLanes[manager->shardIndexOf(routingKey)]->channel;
+    }
+
+    // 下游积压时调用 applyBackpressure(true)，回落后调用 applyBackpressure(false)，两者必须成对。
+    // 例如监听器把数据转存进自己的有界收件箱时，用收件箱的水位回调调用它，生产者通过 isThrottled() 看到
+    void applyBackpressure(bool on) const {
+        // 与 replaceSlot 互斥，计数不会留在被替换掉的旧槽位上
+        std::lock_guard<std::mutex> lock(manager->channelListenersMutex);
+        manager->slotOf<T>(channelId)->backpressure.fetch_add(on ? 1 : -1, std::memory_order_release);
+    }
+
+    // 生产者据此自我节流：路由键所在的队列超过高水位，或者有下游通过 applyBackpressure() 要求暂停。
+    // 不取通道对象的引用，不影响 createChannel 重新创建通道
+    bool isThrottled(std::string_view routingKey = {}) const {
+        auto *slot = manager->slotOf<T>(channelId);
+        if (slot->backpressure.load(std::memory_order_acquire) > 0) {
+            return true;
+        }
+        if (slot->shardLanes.empty()) {
+            return slot->lane.channel.isAboveHighWater();
+        }
+        return slot->shardLanes[manager->shardIndexOf(routingKey)]->channel.isAboveHighWater();
+    }
+
+    ChannelId id() const {
+        return channelId;
+    }
+
+    explicit operator bool() const {
+        return manager != nullptr;
+    }
+
+private:
+    friend class Manager;
+
+    ChannelHandle(Manager *manager, ChannelId channelId) : manager(manager), channelId(channelId) {}
+
+    Manager *manager = nullptr;
+    ChannelId channelId = 0;
+};
+
+// Manager::nextEvent<T>() 返回的 awaitable。挂起时订阅一个一次性的监听器，恢复后取消订阅
+template<typename T>
+class EventAwaiter {
+public:
+    EventAwaiter(Manager &manager, EventTypeId eventType)
+            : manager(manager), eventType(eventType), state(std::make_shared<State>()) {
+        state->pool = coroutinePool().load(std::memory_order_acquire);
+    }
+
+    bool await_ready() const noexcept {
+        return false;
+    }
+
+    void await_suspend(std::coroutine_handle<> handle) {
+        // 监听器可能在 subscribeEvent 返回之前就恢复协程并释放这个 awaiter，之后只使用局部变量
+        std::shared_ptr<State> shared = state;
+        shared->handle = handle;
+        ListenerId id = manager.subscribeEvent(eventType, [shared](const std::shared_ptr<Event> &event) {
+            auto typed = eventCast<T>(event);
+            if (!typed || shared->fired.exchange(true, std::memory_order_acq_rel)) {
+                return;
+            }
+            shared->event = std::move(typed);
+            resumeOn(shared->pool, shared->handle);
+        });
+        shared->listenerId.store(id, std::memory_order_release);
+    }
+
+    std::shared_ptr<T> await_resume() {
+        // 协程可能在 await_suspend 记下编号之前就已经恢复
+        ListenerId id;
+        while ((id = state->listenerId.load(std::memory_order_acquire)) == 0) {
+            std::this_thread::yield();
+        }
+        manager.unsubscribeEvent(eventType, id);
+        return std::move(state->event);
+    }
+
+private:
+    struct State {
+        std::coroutine_handle<> handle;
+        ThreadPool *pool = nullptr;
+        std::atomic<bool> fired{false};
+        std::atomic<ListenerId> listenerId{0};
+        std::shared_ptr<T> event;
+    };
+
+    Manager &manager;
+    EventTypeId eventType;
+    std::shared_ptr<State> state;
+};
+
+// co_await sleepFor(d) 挂起协程，d 之后在线程池上恢复；计时由 Manager 的定时器完成，需要 run() 在运行
+class SleepAwaiter {
+public:
+    explicit SleepAwaiter(steady_clock::duration delay)
+            : delay(delay), pool(coroutinePool().load(std::memory_order_acquire)) {}
+
+    bool await_ready() const noexcept {
+        return delay <= steady_clock::duration::zero();
+    }
+
+    void await_suspend(std::coroutine_handle<> handle) {
+        Manager::getInstance().scheduleAfter(delay, [pool = pool, handle] { resumeOn(pool, handle); });
+    }
+
+    void await_resume() const noexcept {}
+
+private:
+    steady_clock::duration delay;
+    ThreadPool *pool;
+};
+
+inline SleepAwaiter sleepFor(steady_clock::duration delay) {
+    return SleepAwaiter(delay);
+}
+
+
+Manager::Manager(const ManagerConfig &config)
+        : threadPool(std::make_unique<ThreadPool>(config.threadPoolThreads, config.threadPoolPlacement)),
+          eventDispatchLatency(MetricsRegistry::instance().histogram(
+                  "eventloop_event_dispatch_latency_seconds", {}, "Time from publishEvent to the first handler")),
+          eventsDispatched(MetricsRegistry::instance().counter(
+                  "eventloop_events_dispatched_total", {}, "Events handed to their listeners")) {
+    instanceCreated.store(true, std::memory_order_release);
+    strands = std::make_unique<StrandGroup>(*threadPool, config.strands);
+    std::vector<int> cpus = config.shardPlacement.plan(config.shards);
+    for (size_t i = 0; i < config.shards; ++i) {
+        shards.push_back(std::make_unique<Reactor>(i, cpus[i], config.shardPlacement.threadName(i)));
+    }
+    // 协程默认在 Manager 的线程池上恢复
+    coroutinePool().store(threadPool.get(), std::memory_order_release);
+
+    eventQueueMetric = MetricsRegistry::instance().observe("eventloop_event_queue_depth", {}, MetricType::Gauge, [this] {
+        std::lock_guard<std::mutex> lock(eventMutex);
+        size_t depth = 0;
+        for (auto &queue: eventQueues) {
+            depth += queue.size();
+        }
+        return static_cast<double>(depth);
+    }, "Events published but not yet taken by the event loop");
+    if (!config.metrics.file.empty() || config.metrics.port != 0) {
+        metricsExporter = std::make_unique<MetricsExporter>(MetricsRegistry::instance(), config.metrics);
+    }
+}
+
+Manager::~Manager() {
+    ThreadPool *pool = threadPool.get();
+    coroutinePool().compare_exchange_strong(pool, nullptr, std::memory_order_acq_rel);
+}
 
 Manager &Manager::getInstance() {
-    static Manager instance;
+    static Manager instance(startupConfig);
     return instance;
 }
 
-void Manager::subscribeEvent(const std::string &eventType, const EventHandler &handler) {
-    std::lock_guard<std::mutex> lock(eventMutex);
-    eventListeners[eventType].push_back(handler);
+void Manager::configure(const ManagerConfig &config) {
+    if (instanceCreated.load(std::memory_order_acquire)) {
+        throw std::logic_error("Manager::configure must be called before the first Manager::getInstance");
+    }
+    startupConfig = config;
 }
 
-void Manager::publishEvent(const std::string &eventType, std::shared_ptr<Event> event) {
-    std::lock_guard<std::mutex> lock(eventMutex);
-    if (eventListeners.find(eventType) != eventListeners.end()) {
-        for (auto &handler: eventListeners[eventType]) {
-            // handler(event);
-            // 改为事件循环
-            eventTaskQueue.emplace(event, handler);
-            std::cout << "Task added to queue" << std::endl;
+size_t Manager::shardIndexOf(std::string_view key) const {
+    return std::hash<std::string_view>{}(key) % shards.size();
+}
+
+Reactor &Manager::shardFor(std::string_view key) {
+    if (shards.empty()) {
+        throw std::logic_error("Manager is not sharded");
+    }
+    return *shards[shardIndexOf(key)];
+}
+
+void Manager::publishEvent(std::string_view key, EventTypeId eventType, std::shared_ptr<Event> event,
+                           Priority priority) {
+    if (shards.empty()) {
+        publishEvent(eventType, std::move(event), priority);
+        return;
+    }
+    auto handlers = eventTypes.get(eventType)->load();
+    if (handlers->empty()) {
+        return;
+    }
+    shardFor(key).post([this, event = std::move(event), handlers = std::move(handlers), published = metricsNow()] {
+        dispatchEvent(event, *handlers, published);
+    }, priority);
+}
+
+void Manager::publishEvent(std::string_view key, const std::string &eventType, std::shared_ptr<Event> event,
+                           Priority priority) {
+    if (auto typeId = eventTypes.find(eventType)) {
+        publishEvent(key, *typeId, std::move(event), priority);
+    }
+}
+
+void Manager::stopShards() {
+    for (auto &shard: shards) {
+        shard->stop();
+    }
+}
+
+EventTypeId Manager::eventType(std::string_view name) {
+    return eventTypes.intern(name, [] { return std::make_shared<CopyOnWrite<EventListenerList>>(); });
+}
+
+ListenerId Manager::subscribeEvent(EventTypeId eventType, const EventHandler &handler) {
+    ListenerId id = nextListenerId.fetch_add(1, std::memory_order_relaxed);
+    eventTypes.get(eventType)->update([&](EventListenerList &listeners) {
+        listeners.push_back({id, handler});
+    });
+    return id;
+}
+
+ListenerId Manager::subscribeEvent(const std::string &eventType, const EventHandler &handler) {
+    return subscribeEvent(this->eventType(eventType), handler);
+}
+
+bool Manager::unsubscribeEvent(EventTypeId eventType, ListenerId id) {
+    return eventTypes.get(eventType)->update([&](EventListenerList &listeners) {
+        return eraseListener(listeners, id);
+    });
+}
+
+bool Manager::unsubscribeEvent(const std::string &eventType, ListenerId id) {
+    auto typeId = eventTypes.find(eventType);
+    return typeId && unsubscribeEvent(*typeId, id);
+}
+
+void Manager::publishEvent(EventTypeId eventType, std::shared_ptr<Event> event, Priority priority) {
+    auto handlers = eventTypes.get(eventType)->load();
+    if (handlers->empty()) {
+        return;
+    }
+    {
+        std::lock_guard<std::mutex> lock(eventMutex);
+        // 改为事件循环
+        eventQueues[priorityIndex(priority)].push_back({std::move(event), std::move(handlers), metricsNow()});
+        if (priority == Priority::High) {
+            highPriorityPending.store(true, std::memory_order_release);
+        }
+    }
+    eventCond.notify_one();
+}
+
+void Manager::publishEvent(const std::string &eventType, std::shared_ptr<Event> event, Priority priority) {
+    // 没有注册过的事件类型一定没有监听器
+    if (auto typeId = eventTypes.find(eventType)) {
+        publishEvent(*typeId, std::move(event), priority);
+    }
+}
+
+void Manager::dispatchEvent(const std::shared_ptr<Event> &event, const EventListenerList &handlers) {
+    for (auto &handler: handlers) {
+        try {
+            handler.fn(event);
+        } catch (const std::exception &e) {
+            LOG_ERROR("Event handler threw: ", e.what());
+        }
+    }
+}
+
+void Manager::dispatchEvent(const std::shared_ptr<Event> &event, const EventListenerList &handlers,
+                            int64_t publishedNanos) {
+    eventDispatchLatency.record(nanoseconds(metricsNow() - publishedNanos));
+    eventsDispatched.add();
+    dispatchEvent(event, handlers);
+}
+
+void Manager::runHighPriorityEvents(EventBatch &urgent) {
+    {
+        std::lock_guard<std::mutex> lock(eventMutex);
+        urgent.swap(eventQueues[priorityIndex(Priority::High)]);
+        highPriorityPending.store(false, std::memory_order_relaxed);
+    }
+    for (auto &[event, handlers, published]: urgent) {
+        dispatchEvent(event, *handlers, published);
+    }
+    urgent.clear();
+}
+
+bool Manager::unsubscribeChannel(const std::string &channelName, ListenerId id) {
+    auto channelId = channels.find(channelName);
+    return channelId && removeChannelListener(*channelId, id);
+}
+
+bool Manager::removeChannelListener(ChannelId channelId, ListenerId id) {
+    std::lock_guard<std::mutex> lock(channelListenersMutex);
+    return channels.get(channelId)->removeListener(id);
+}
+
+template<typename Entries>
+bool Manager::eraseListener(Entries &entries, ListenerId id) {
+    for (auto it = entries.begin(); it != entries.end(); ++it) {
+        if (it->id == id) {
+            entries.erase(it);
+            return true;
+        }
+    }
+    return false;
+}
+
+void Manager::stop() {
+    {
+        std::lock_guard<std::mutex> lock(eventMutex);
+        stopRequested = true;
+    }
+    eventCond.notify_one();
+}
+
+TimerId Manager::scheduleAfter(steady_clock::duration delay, Task callback) {
+    return scheduleTimer(steady_clock::now() + delay, steady_clock::duration::zero(), std::move(callback));
+}
+
+TimerId Manager::scheduleEvery(steady_clock::duration period, Task callback) {
+    if (period <= steady_clock::duration::zero()) {
+        throw std::invalid_argument("timer period must be positive");
+    }
+    return scheduleTimer(steady_clock::now() + period, period, std::move(callback));
+}
+
+TimerId Manager::scheduleTimer(steady_clock::time_point when, steady_clock::duration period, Task callback) {
+    TimerId id;
+    bool wake = false;
+    {
+        std::lock_guard<std::mutex> lock(eventMutex);
+        id = timers.schedule(when, period, std::move(callback));
+        // 只有比事件循环当前的睡眠时间更早到期时才需要唤醒它
+        if (when < loopWakeAt) {
+            timersChanged = true;
+            wake = true;
         }
     }
+    if (wake) {
+        eventCond.notify_one();
+    }
+    return id;
 }
 
+bool Manager::cancel(TimerId id) {
+    std::lock_guard<std::mutex> lock(eventMutex);
+    return timers.cancel(id);
+}
+
+// 通道已经以其他数据类型创建时抛出 std::logic_error，而不是在工作线程上出现未定义行为
 template<typename T>
-void Manager::subscribeChannel(const std::string &channelName, std::function<void(T)> listener) {
-    // 将listener封装为接受std::any的函数，然后存储
-    std::function<void(std::any)> anyListener = [listener](std::any data) {
-        listener(std::any_cast<T>(data));
-    };
-    channelListeners[channelName].push_back(anyListener);
+ChannelId Manager::internChannel(std::string_view channelName) {
+    ChannelId id = channels.intern(channelName, [this, channelName] {
+        return std::make_shared<ChannelSlot<T>>(shards, std::string(channelName));
+    });
+    if (channels.get(id)->typeTag != &typeTagOf<T>) {
+        throw std::logic_error("channel " + std::string(channelName) + " already exists with a different data type");
+    }
+    return id;
 }
 
 template<typename T>
-void Manager::publishToChannel(const std::string &channelName, T data) {
-    if (channelListeners.find(channelName) != channelListeners.end()) {
-        for (auto &listener: channelListeners[channelName]) {
-            // 将数据封装为std::any类型
-            std::any anyData = data;
+ChannelHandle<T> Manager::channel(std::string_view channelName) {
+    return ChannelHandle<T>(this, internChannel<T>(channelName));
+}
 
-            // 使用线程池异步执行监听器
-            std::cout << "Enqueueing channel listener" << std::endl;
-            getThreadPool().enqueue([listener, anyData]() {
-                // 在这个lambda表达式中调用监听器
-                listener(anyData);
-            });
+template<typename T>
+ListenerId Manager::subscribeSlot(ChannelId channelId, std::function<void(T)> listener) {
+    std::lock_guard<std::mutex> lock(channelListenersMutex);
+    auto *slot = slotOf<T>(channelId);
+    ListenerId id = nextListenerId.fetch_add(1, std::memory_order_relaxed);
+    slot->listeners.update([&](ChannelListeners<T> &listeners) {
+        checkMoveOnlyListener(channelId, listeners, false);
+        listeners.byValue.push_back({id, std::move(listener)});
+    });
+    // 新版本发布之后再计数，发布者看到计数时分发任务一定能看到这个监听器
+    slot->listenerCount.fetch_add(1, std::memory_order_release);
+    return id;
+}
+
+template<typename T>
+ListenerId Manager::subscribeBroadcastSlot(ChannelId channelId, SharedChannelHandler<T> listener) {
+    std::lock_guard<std::mutex> lock(channelListenersMutex);
+    auto *slot = slotOf<T>(channelId);
+    ListenerId id = nextListenerId.fetch_add(1, std::memory_order_relaxed);
+    slot->listeners.update([&](ChannelListeners<T> &listeners) {
+        checkMoveOnlyListener(channelId, listeners, true);
+        listeners.shared.push_back({id, std::move(listener)});
+    });
+    slot->listenerCount.fetch_add(1, std::memory_order_release);
+    return id;
+}
+
+template<typename T>
+ListenerId Manager::subscribeChannel(const std::string &channelName, std::function<void(T)> listener) {
+    using Value = std::decay_t<T>;
+    return channel<Value>(channelName).subscribe(std::move(listener));
+}
+
+template<typename T>
+ListenerId Manager::subscribeChannel(const ChannelKey<T> &key, std::type_identity_t<std::function<void(T)>> listener) {
+    return channel(key).subscribe(std::move(listener));
+}
+
+template<typename T>
+ListenerId Manager::subscribeBroadcast(const std::string &channelName, SharedChannelHandler<T> listener) {
+    return channel<T>(channelName).subscribeBroadcast(std::move(listener));
+}
 
-            // 同步调用监听器
-//            std::cout << "Calling channel listener" << std::endl;
-//            listener(anyData);
+template<typename T>
+ListenerId Manager::subscribeBroadcast(const ChannelKey<T> &key,
+                                       std::type_identity_t<SharedChannelHandler<T>> listener) {
+    return channel(key).subscribeBroadcast(std::move(listener));
+}
+
+// 只能移动的数据只能交给一个按值监听器，或者只交给广播监听器
+template<typename T>
+void Manager::checkMoveOnlyListener(ChannelId id, const ChannelListeners<T> &listeners, bool broadcast) {
+    if constexpr (!std::is_copy_constructible_v<T>) {
+        bool conflict = !listeners.byValue.empty() || (!broadcast && !listeners.shared.empty());
+        if (conflict) {
+            throw std::logic_error("move-only channel cannot have more than one listener: " + channels.nameOf(id));
         }
     }
 }
 
 template<typename T>
-Channel<T> &Manager::Manager::getOrCreateChannel(const std::string &channelName) {
-    std::lock_guard<std::mutex> lock(channelMutex);
-    auto it = channels.find(channelName);
-    if (it != channels.end()) {
-        return *std::static_pointer_cast<Channel<T>>(it->second);
+SendStatus Manager::publishToChannel(const std::string &channelName, T &&data, Priority priority) {
+    return channel<std::decay_t<T>>(channelName).publish(std::forward<T>(data), priority);
+}
+
+template<typename T, typename U>
+SendStatus Manager::publishToChannel(const ChannelKey<T> &key, U &&data, Priority priority) {
+    return channel(key).publish(std::forward<U>(data), priority);
+}
+
+template<typename T, typename U>
+SendStatus Manager::publishToChannel(const ChannelKey<T> &key, std::string_view routingKey, U &&data,
+                                     Priority priority) {
+    return channel(key).publish(routingKey, std::forward<U>(data), priority);
+}
+
+template<typename T, typename U>
+SendStatus Manager::publishSlot(ChannelId id, U &&data, Priority priority) {
+    auto *slot = slotOf<T>(id);
+    return publishLane(slot, &slot->lane, std::forward<U>(data), priority);
+}
+
+template<typename T, typename U>
+SendStatus Manager::publishSlot(ChannelId id, std::string_view routingKey, U &&data, Priority priority) {
+    auto *slot = slotOf<T>(id);
+    if (slot->shardLanes.empty()) {
+        return publishLane(slot, &slot->lane, std::forward<U>(data), priority);
+    }
+    return publishLane(slot, slot->shardLanes[shardIndexOf(routingKey)].get(), std::forward<U>(data), priority);
+}
+
+template<typename T, typename U>
+SendStatus Manager::publishLane(ChannelSlot<T> *slot, ChannelLane<T> *lane, U &&data, Priority priority) {
+    if (slot->listenerCount.load(std::memory_order_acquire) == 0) {
+        return SendStatus::Dropped;
+    }
+
+    // 入队后再调度分发任务：通道非空时一定有分发任务在排队或运行
+    SendStatus status;
+    if constexpr (std::is_same_v<std::decay_t<U>, T>) {
+        status = lane->channel.send(std::forward<U>(data), priority);
     } else {
-        auto channel = std::make_shared<Channel<T>>(channelName);
-        channels[channelName] = channel;
-        return *channel;
+        status = lane->channel.send(T(std::forward<U>(data)), priority);
     }
+    if (status == SendStatus::Ok || status == SendStatus::DroppedOldest) {
+        scheduleDispatch(slot, lane);
+    }
+    return status;
+}
+
+template<typename T>
+void Manager::scheduleDispatch(ChannelSlot<T> *slot, ChannelLane<T> *lane) {
+    if (lane->dispatchScheduled.exchange(true, std::memory_order_seq_cst)) {
+        return;
+    }
+    postDispatch(slot, lane);
+}
+
+// 分片的队列在分片线程上分发，其余在线程池上分发
+template<typename T>
+void Manager::postDispatch(ChannelSlot<T> *slot, ChannelLane<T> *lane) {
+    if (lane->reactor) {
+        lane->reactor->post([this, slot, lane] { dispatchChannel(slot, lane); });
+    } else {
+        getThreadPool().post([this, slot, lane] { dispatchChannel(slot, lane); });
+    }
+}
+
+// 在线程池或分片线程上运行：按发送顺序把队列中的一批消息交给该通道的所有监听器
+// 按值监听器各拿一份拷贝；有广播监听器时原数据装箱为 shared_ptr<const T> 一次，所有广播监听器共享，
+// 否则最后一个按值监听器拿走原数据。只有一个监听器时整条链路上没有拷贝
+template<typename T>
+void Manager::dispatchChannel(ChannelSlot<T> *slot, ChannelLane<T> *lane) {
+    std::vector<T> batch;
+    batch.reserve(DISPATCH_BATCH);
+    lane->channel.tryReceiveBulk(batch, DISPATCH_BATCH);
+
+    auto snapshot = slot->listeners.load();
+    const auto &listeners = snapshot->byValue;
+    const auto &sharedListeners = snapshot->shared;
+
+    for (auto &data: batch) {
+        for (size_t i = 0; i < listeners.size(); ++i) {
+            try {
+                if (i + 1 == listeners.size() && sharedListeners.empty()) {
+                    listeners[i].fn(std::move(data));
+                } else if constexpr (std::is_copy_constructible_v<T>) {
+                    listeners[i].fn(data);
+                }
+            } catch (const std::exception &e) {
+                LOG_ERROR("Channel listener on ", lane->channel.getName(), " threw: ", e.what());
+            }
+        }
+        if (sharedListeners.empty()) {
+            continue;
+        }
+        std::shared_ptr<const T> payload = std::make_shared<const T>(std::move(data));
+        for (auto &listener: sharedListeners) {
+            try {
+                listener.fn(payload);
+            } catch (const std::exception &e) {
+                LOG_ERROR("Channel listener on ", lane->channel.getName(), " threw: ", e.what());
+            }
+        }
+    }
+
+    if (batch.size() == DISPATCH_BATCH) {
+        // 还有积压，重新投递而不是一直占着工作线程
+        postDispatch(slot, lane);
+        return;
+    }
+    lane->dispatchScheduled.store(false, std::memory_order_seq_cst);
+    // 与 publishToChannel 中“先入队再 exchange”配对：清除标志后再检查一次，避免遗漏刚入队的数据
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    if (!lane->channel.empty()) {
+        scheduleDispatch(slot, lane);
+    }
+}
+
+// 重新创建通道时保留已经订阅的监听器；旧通道中尚未分发的数据由已排队的分发任务处理完。
+// 从复制监听器到替换槽位期间持有 channelListenersMutex，并发的订阅不会落在即将被替换的旧槽位上
+template<typename T, typename... Args>
+void Manager::replaceSlot(const std::string &channelName, Args &&... args) {
+    ChannelId id = internChannel<T>(channelName);
+    auto slot = std::make_shared<ChannelSlot<T>>(shards, channelName, std::forward<Args>(args)...);
+    std::lock_guard<std::mutex> lock(channelListenersMutex);
+    if (slotOf<T>(id)->referenced.load(std::memory_order_relaxed)) {
+        throw std::logic_error("channel " + channelName + " cannot be recreated after a reference to it was taken");
+    }
+    auto listeners = slotOf<T>(id)->listeners.load();
+    slot->listeners.update([&](ChannelListeners<T> &copy) { copy = *listeners; });
+    slot->listenerCount.store(listeners->byValue.size() + listeners->shared.size(), std::memory_order_release);
+    slot->backpressure.store(slotOf<T>(id)->backpressure.load(std::memory_order_acquire), std::memory_order_release);
+    channels.replace(id, std::move(slot));
+}
+
+template<typename T>
+Channel<T> &Manager::getOrCreateChannel(const std::string &channelName) {
+    return channel<T>(channelName).get();
 }
 
 template<typename T>
 void Manager::createChannel(const std::string &channelName) {
-    std::lock_guard<std::mutex> lock(channelMutex);
-    auto channel = std::make_shared<Channel<T>>(channelName);
-    channels[channelName] = channel;
+    replaceSlot<T>(channelName);
+}
+
+template<typename T>
+void Manager::createChannel(const std::string &channelName, size_t capacity, ChannelMode mode) {
+    replaceSlot<T>(channelName, capacity, mode);
+}
+
+template<typename T>
+void Manager::createChannel(const std::string &channelName, const ChannelConfig &config) {
+    replaceSlot<T>(channelName, config);
 }
 
 // 事件循环
 void Manager::run(high_resolution_clock::duration runtime) {
     _start_time = high_resolution_clock::now();
-    // _elapsed 在循环内部更新
-
-    while (true) { // 修改循环条件
-        std::cout << "Event loop running" << std::endl;
-        std::cout << "Event queue size: " << eventTaskQueue.size() << std::endl;
+    // 截止时间用 steady_clock 计算，不受系统时间调整影响
+    const auto deadline = steady_clock::now() + duration_cast<steady_clock::duration>(runtime);
+    std::array<EventBatch, PRIORITY_LEVELS> batches;
+    EventBatch urgent;
+    std::vector<std::shared_ptr<TimerWheel::Timer>> expiredTimers;
+    LOG_INFO("Event loop running");
 
-        // 在循环内部更新_elapsed，以确保能够获取最新的经过时间
-        _elapsed = high_resolution_clock::now() - _start_time;
-        std::cout << "Elapsed time: " << duration_cast<seconds>(_elapsed).count() << "s" << std::endl;
-
-        // 检查是否超过了指定的运行时间
-        if (_elapsed >= runtime) {
-            break; // 终止循环
+    while (true) {
+        {
+            std::unique_lock<std::mutex> lock(eventMutex);
+            // 睡眠直到有事件、请求停止、定时器到期或到达截止时间
+            loopWakeAt = deadline;
+            if (auto next = timers.nextExpiry(); next && *next < loopWakeAt) {
+                loopWakeAt = *next;
+            }
+            timersChanged = false;
+            eventCond.wait_until(lock, loopWakeAt, [this] {
+                return stopRequested || timersChanged
+                       || std::any_of(eventQueues.begin(), eventQueues.end(),
+                                      [](const EventBatch &queue) { return !queue.empty(); });
+            });
+            auto now = steady_clock::now();
+            // 检查是否超过了指定的运行时间
+            if (stopRequested || now >= deadline) {
+                stopRequested = false;
+                loopWakeAt = steady_clock::time_point::max();
+                break; // 终止循环
+            }
+            // 处理期间新加入的定时器不必唤醒事件循环，下一轮开始时会重新计算睡眠时间
+            loopWakeAt = steady_clock::time_point::min();
+            timers.advance(now, expiredTimers);
+            for (size_t i = 0; i < PRIORITY_LEVELS; ++i) {
+                batches[i].swap(eventQueues[i]);
+            }
+            highPriorityPending.store(false, std::memory_order_relaxed);
         }
 
-        if (eventTaskQueue.empty()) {
-            std::this_thread::sleep_for(std::chrono::milliseconds(200));
-            continue;
+        for (auto &timer: expiredTimers) {
+            if (timer->cancelled.load(std::memory_order_relaxed)) {
+                continue;
+            }
+            try {
+                timer->callback();
+            } catch (const std::exception &e) {
+                LOG_ERROR("Timer callback threw: ", e.what());
+            }
         }
+        expiredTimers.clear();
 
-        auto [event, handler] = eventTaskQueue.front();
-        std::cout << "Processing event task" << std::endl;
-        std::cout << "StatusChangeEvent " << std::endl;
-        handler(event);
-        std::cout << "event Task processed" << std::endl;
-        eventTaskQueue.pop();
+        // 按优先级处理；处理积压的低优先级事件期间新到达的高优先级事件插到前面
+        for (size_t i = 0; i < PRIORITY_LEVELS; ++i) {
+            for (auto &[event, handlers, published]: batches[i]) {
+                if (i != priorityIndex(Priority::High) && highPriorityPending.load(std::memory_order_acquire)) {
+                    runHighPriorityEvents(urgent);
+                }
+                dispatchEvent(event, *handlers, published);
+            }
+            batches[i].clear();
+        }
     }
-    std::cout << "Event loop stopped" << std::endl;
+
+    _elapsed = high_resolution_clock::now() - _start_time;
+    LOG_INFO("Event loop stopped after ", duration_cast<milliseconds>(_elapsed).count(), "ms");
 }
 
 
@@ -0,0 +1,407 @@
+#ifndef EVENTLOOPMANAGER_METRICS_H
+#define EVENTLOOPMANAGER_METRICS_H
+
+#include <algorithm>
+#include <atomic>
+#include <bit>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <functional>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+#include "CacheLine.h"
+
+// 计数器的分片数；每个线程固定写其中一个分片，线程数不超过分片数时互不竞争
+inline constexpr size_t METRIC_SHARDS = 16;
+
+// 当前线程使用的分片编号，线程第一次写指标时轮流分配
+inline size_t metricShard() {
+    static std::atomic<size_t> nextShard{0};
+    thread_local size_t shard = nextShard.fetch_add(1, std::memory_order_relaxed) % METRIC_SHARDS;
+    return shard;
+}
+
+// steady_clock 纪元以来的纳秒，用于计算延迟
+inline int64_t metricsNow() {
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(
+            std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+// 只增不减的计数器，按线程分片：写入是对本线程分片的一次 relaxed 加法，读取时汇总所有分片
+class MetricCounter {
+public:
+    void add(uint64_t n = 1) {
+        cells[metricShard()].value.fetch_add(n, std::memory_order_relaxed);
+    }
+
+    uint64_t value() const {
+        uint64_t total = 0;
+        for (auto &cell: cells) {
+            total += cell.value.load(std::memory_order_relaxed);
+        }
+        return total;
+    }
+
+private:
+    struct alignas(CACHE_LINE_SIZE) Cell {
+        std::atomic<uint64_t> value{0};
+    };
+
+    Cell cells[METRIC_SHARDS];
+};
+
+// 可增可减的瞬时值
+class MetricGauge {
+public:
+    void set(int64_t v) {
+        current.store(v, std::memory_order_relaxed);
+    }
+
+    void add(int64_t n) {
+        current.fetch_add(n, std::memory_order_relaxed);
+    }
+
+    int64_t value() const {
+        return current.load(std::memory_order_relaxed);
+    }
+
+private:
+    std::atomic<int64_t> current{0};
+};
+
+// LatencyHistogram 的快照，数值单位为纳秒
+struct HistogramSnapshot {
+    uint64_t count = 0;
+    uint64_t sum = 0;
+    uint64_t max = 0;
+    std::vector<uint64_t> buckets;
+
+    // 分位数 q（0~1）所在桶的上界，不超过记录到的最大值
+    uint64_t percentile(double q) const;
+};
+
+/*
+ * HDR 风格的对数-线性直方图：按最高有效位分组，每组再均分成 2^SUB_BUCKET_BITS 个桶，
+ * 任意量级的相对误差都不超过 1/16；0~31 纳秒每个值一个桶，最大可以记录 2^64-1。
+ * 记录是对桶计数和总和的两次 relaxed 加法，按线程分到 HISTOGRAM_SHARDS 份桶数组上，减少多线程争用。
+ */
+class LatencyHistogram {
+public:
+    static constexpr unsigned SUB_BUCKET_BITS = 4;
+    static constexpr size_t SUB_BUCKETS = size_t(1) << SUB_BUCKET_BITS;
+    static constexpr size_t BUCKETS = SUB_BUCKETS * (64 - SUB_BUCKET_BITS + 1);
+    static constexpr size_t HISTOGRAM_SHARDS = 4;
+
+    void record(uint64_t nanos) {
+        Shard &shard = shards[metricShard() % HISTOGRAM_SHARDS];
+        shard.buckets[bucketIndex(nanos)].fetch_add(1, std::memory_order_relaxed);
+        shard.sum.fetch_add(nanos, std::memory_order_relaxed);
+        uint64_t max = shard.max.load(std::memory_order_relaxed);
+        while (nanos > max && !shard.max.compare_exchange_weak(max, nanos, std::memory_order_relaxed)) {}
+    }
+
+    void record(std::chrono::nanoseconds latency) {
+        record(static_cast<uint64_t>(std::max<int64_t>(latency.count(), 0)));
+    }
+
+    HistogramSnapshot snapshot() const {
+        HistogramSnapshot result;
+        result.buckets.assign(BUCKETS, 0);
+        for (auto &shard: shards) {
+            for (size_t i = 0; i < BUCKETS; ++i) {
+                uint64_t n = shard.buckets[i].load(std::memory_order_relaxed);
+                result.buckets[i] += n;
+                result.count += n;
+            }
+            result.sum += shard.sum.load(std::memory_order_relaxed);
+            result.max = std::max(result.max, shard.max.load(std::memory_order_relaxed));
+        }
+        return result;
+    }
+
+    static size_t bucketIndex(uint64_t value) {
+        if (value < SUB_BUCKETS) {
+            return static_cast<size_t>(value);
+        }
+        unsigned msb = static_cast<unsigned>(std::bit_width(value)) - 1;
+        unsigned shift = msb - SUB_BUCKET_BITS;
+        return (msb - SUB_BUCKET_BITS + 1) * SUB_BUCKETS + static_cast<size_t>((value >> shift) - SUB_BUCKETS);
+    }
+
+    // 桶中的最大值
+    static uint64_t bucketUpperBound(size_t index) {
+        size_t group = index / SUB_BUCKETS;
+        uint64_t sub = index % SUB_BUCKETS;
+        if (group == 0) {
+            return sub;
+        }
+        unsigned shift = static_cast<unsigned>(group) - 1;
+        uint64_t next = SUB_BUCKETS + sub + 1;
+        // 最高一组的最后一个桶到 2^64-1 为止
+        if (std::bit_width(next) + shift > 64) {
+            return UINT64_MAX;
+        }
+        return (next << shift) - 1;
+    }
+
+private:
+    struct alignas(CACHE_LINE_SIZE) Shard {
+        std::atomic<uint64_t> buckets[BUCKETS]{};
+        std::atomic<uint64_t> sum{0};
+        std::atomic<uint64_t> max{0};
+    };
+
+    Shard shards[HISTOGRAM_SHARDS];
+};
+
+inline uint64_t HistogramSnapshot::percentile(double q) const {
+    if (count == 0) {
+        return 0;
+    }
+    auto rank = static_cast<uint64_t>(q * static_cast<double>(count - 1)) + 1;
+    uint64_t seen = 0;
+    for (size_t i = 0; i < buckets.size(); ++i) {
+        seen += buckets[i];
+        if (seen >= rank) {
+            return std::min(LatencyHistogram::bucketUpperBound(i), max);
+        }
+    }
+    return max;
+}
+
+enum class MetricType {
+    Counter,
+    Gauge,
+    Histogram
+};
+
+class MetricsRegistry;
+
+// MetricsRegistry::observe() 返回的登记，析构时注销回调；注销会等待正在进行的采集结束
+class MetricsRegistration {
+public:
+    MetricsRegistration() = default;
+
+    MetricsRegistration(MetricsRegistry *registry, uint64_t id) : registry(registry), id(id) {}
+
+    MetricsRegistration(MetricsRegistration &&other) noexcept
+            : registry(std::exchange(other.registry, nullptr)), id(other.id) {}
+
+    MetricsRegistration &operator=(MetricsRegistration &&other) noexcept {
+        if (this != &other) {
+            reset();
+            registry = std::exchange(other.registry, nullptr);
+            id = other.id;
+        }
+        return *this;
+    }
+
+    MetricsRegistration(const MetricsRegistration &) = delete;
+    MetricsRegistration &operator=(const MetricsRegistration &) = delete;
+
+    ~MetricsRegistration() {
+        reset();
+    }
+
+    void reset();
+
+private:
+    MetricsRegistry *registry = nullptr;
+    uint64_t id = 0;
+};
+
+/*
+ * 进程内的指标注册表。
+ * 指标按“名字 + 标签”登记，同名同标签返回同一个对象；counter() / gauge() / histogram() 返回的引用在进程内一直有效，
+ * 热路径上保存引用直接写入，不再查表。已经自己计数的组件（通道、Kafka 生产者）用 observe() 登记取值回调，
+ * 采集时才读取。标签是预先拼好的 key="value" 列表，用 label() 生成。
+ * prometheusText() 输出 Prometheus 文本格式；直方图输出为 summary（分位数、_sum、_count），单位为秒。
+ */
+class MetricsRegistry {
+public:
+    static MetricsRegistry &instance() {
+        static MetricsRegistry registry;
+        return registry;
+    }
+
+    MetricsRegistry() = default;
+
+    MetricsRegistry(const MetricsRegistry &) = delete;
+    MetricsRegistry &operator=(const MetricsRegistry &) = delete;
+
+    MetricCounter &counter(const std::string &name, const std::string &labels = {}, const std::string &help = {}) {
+        std::lock_guard<std::mutex> lock(mutex);
+        return getOrCreate(family(name, MetricType::Counter, help).counters, labels);
+    }
+
+    MetricGauge &gauge(const std::string &name, const std::string &labels = {}, const std::string &help = {}) {
+        std::lock_guard<std::mutex> lock(mutex);
+        return getOrCreate(family(name, MetricType::Gauge, help).gauges, labels);
+    }
+
+    LatencyHistogram &histogram(const std::string &name, const std::string &labels = {},
+                                const std::string &help = {}) {
+        std::lock_guard<std::mutex> lock(mutex);
+        return getOrCreate(family(name, MetricType::Histogram, help).histograms, labels);
+    }
+
+    // 登记一个计数器或瞬时值的取值回调。回调在采集线程上调用，不能再调用注册表；
+    // 同名同标签的多个回调在输出时相加
+    MetricsRegistration observe(const std::string &name, const std::string &labels, MetricType type,
+                                std::function<double()> fn, const std::string &help = {}) {
+        if (type == MetricType::Histogram) {
+            throw std::invalid_argument("observed metrics must be counters or gauges: " + name);
+        }
+        std::lock_guard<std::mutex> lock(mutex);
+        uint64_t id = nextObservedId++;
+        family(name, type, help).observed.emplace(id, Observed{labels, std::move(fn)});
+        observedFamilies.emplace(id, name);
+        return MetricsRegistration(this, id);
+    }
+
+    // 生成一个标签，值中的 \、" 和换行按 Prometheus 的规则转义
+    static std::string label(std::string_view key, std::string_view value) {
+        std::string result(key);
+        result += "=\"";
+        for (char c: value) {
+            if (c == '\\' || c == '"') {
+                result += '\\';
+                result += c;
+            } else if (c == '\n') {
+                result += "\\n";
+            } else {
+                result += c;
+            }
+        }
+        result += '"';
+        return result;
+    }
+
+    std::string prometheusText() const {
+        std::string out;
+        std::lock_guard<std::mutex> lock(mutex);
+        for (auto &[name, f]: families) {
+            if (!f.help.empty()) {
+                out.append("# HELP ").append(name).append(" ").append(f.help).append("\n");
+            }
+            out.append("# TYPE ").append(name).append(f.type == MetricType::Counter ? " counter\n"
+                                                      : f.type == MetricType::Gauge ? " gauge\n" : " summary\n");
+            if (f.type == MetricType::Histogram) {
+                for (auto &[labels, histogram]: f.histograms) {
+                    appendSummary(out, name, labels, histogram->snapshot());
+                }
+                continue;
+            }
+            std::map<std::string, double> samples;
+            for (auto &[labels, counter]: f.counters) {
+                samples[labels] += static_cast<double>(counter->value());
+            }
+            for (auto &[labels, gauge]: f.gauges) {
+                samples[labels] += static_cast<double>(gauge->value());
+            }
+            for (auto &[id, observed]: f.observed) {
+                samples[observed.labels] += observed.fn();
+            }
+            for (auto &[labels, value]: samples) {
+                appendSample(out, name, labels, value);
+            }
+        }
+        return out;
+    }
+
+private:
+    friend class MetricsRegistration;
+
+    struct Observed {
+        std::string labels;
+        std::function<double()> fn;
+    };
+
+    struct Family {
+        MetricType type;
+        std::string help;
+        std::map<std::string, std::unique_ptr<MetricCounter>> counters;
+        std::map<std::string, std::unique_ptr<MetricGauge>> gauges;
+        std::map<std::string, std::unique_ptr<LatencyHistogram>> histograms;
+        std::map<uint64_t, Observed> observed;
+    };
+
+    // 调用方持有 mutex；同名指标的类型必须一致
+    Family &family(const std::string &name, MetricType type, const std::string &help) {
+        auto [it, inserted] = families.try_emplace(name);
+        if (inserted) {
+            it->second.type = type;
+        } else if (it->second.type != type) {
+            throw std::logic_error("metric registered with a different type: " + name);
+        }
+        if (it->second.help.empty()) {
+            it->second.help = help;
+        }
+        return it->second;
+    }
+
+    template<typename Metric>
+    static Metric &getOrCreate(std::map<std::string, std::unique_ptr<Metric>> &metrics, const std::string &labels) {
+        auto &metric = metrics[labels];
+        if (!metric) {
+            metric = std::make_unique<Metric>();
+        }
+        return *metric;
+    }
+
+    void remove(uint64_t id) {
+        std::lock_guard<std::mutex> lock(mutex);
+        auto it = observedFamilies.find(id);
+        if (it == observedFamilies.end()) {
+            return;
+        }
+        families[it->second].observed.erase(id);
+        observedFamilies.erase(it);
+    }
+
+    static void appendSample(std::string &out, const std::string &name, const std::string &labels, double value) {
+        char number[32];
+        std::snprintf(number, sizeof(number), "%.15g", value);
+        out.append(name);
+        if (!labels.empty()) {
+            out.append("{").append(labels).append("}");
+        }
+        out.append(" ").append(number).append("\n");
+    }
+
+    static void appendSummary(std::string &out, const std::string &name, const std::string &labels,
+                              const HistogramSnapshot &snapshot) {
+        static constexpr std::pair<const char *, double> QUANTILES[] = {
+                {"0.5", 0.5}, {"0.9", 0.9}, {"0.99", 0.99}, {"0.999", 0.999}, {"1", 1.0}};
+        std::string prefix = labels.empty() ? std::string() : labels + ",";
+        for (auto &[text, q]: QUANTILES) {
+            appendSample(out, name, prefix + "quantile=\"" + text + "\"",
+                         static_cast<double>(snapshot.percentile(q)) / 1e9);
+        }
+        appendSample(out, name + "_sum", labels, static_cast<double>(snapshot.sum) / 1e9);
+        appendSample(out, name + "_count", labels, static_cast<double>(snapshot.count));
+    }
+
+    mutable std::mutex mutex;
+    std::map<std::string, Family> families;
+    std::unordered_map<uint64_t, std::string> observedFamilies;
+    uint64_t nextObservedId = 1;
+};
+
+inline void MetricsRegistration::reset() {
+    if (registry) {
+        registry->remove(id);
+        registry = nullptr;
+    }
+}
+
+#endif //EVENTLOOPMANAGER_METRICS_H
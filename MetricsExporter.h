@@ -0,0 +1,184 @@
+#ifndef EVENTLOOPMANAGER_METRICSEXPORTER_H
+#define EVENTLOOPMANAGER_METRICSEXPORTER_H
+
+#include <arpa/inet.h>
+#include <fcntl.h>
+#include <netinet/in.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <unistd.h>
+#include <algorithm>
+#include <atomic>
+#include <cerrno>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include "Metrics.h"
+
+// 指标导出配置；file 为空且 port 为 0 时不导出
+struct MetricsExportConfig {
+    // 每隔 interval 把快照写到这个文件（先写临时文件再改名，读者不会看到写了一半的内容）
+    std::string file;
+    // 大于 0 时在 127.0.0.1:port 上提供 Prometheus 文本格式，任意路径的 GET 都返回全部指标
+    uint16_t port = 0;
+    std::chrono::milliseconds interval{1000};
+};
+
+/*
+ * 指标导出线程：定期写快照文件，并在本机端口上应答 Prometheus 的抓取请求。
+ * 采集只在这个线程上进行，热路径上写指标的线程不受影响。
+ */
+class MetricsExporter {
+public:
+    MetricsExporter(MetricsRegistry &registry, const MetricsExportConfig &config)
+            : registry(registry), config(config) {
+        if (config.port != 0) {
+            listenFd = openListener(config.port);
+        }
+        worker = std::thread([this] { exportLoop(); });
+    }
+
+    MetricsExporter(const MetricsExporter &) = delete;
+    MetricsExporter &operator=(const MetricsExporter &) = delete;
+
+    ~MetricsExporter() {
+        running.store(false, std::memory_order_release);
+        worker.join();
+        if (listenFd >= 0) {
+            ::close(listenFd);
+        }
+        // 退出前再写一次，保留最后的计数
+        writeFile();
+    }
+
+private:
+    // 轮询的最长间隔，决定析构时最多等待多久
+    static constexpr int POLL_MILLIS = 100;
+    // 抓取方提前断开时不产生 SIGPIPE；macOS 没有 MSG_NOSIGNAL，改为在套接字上设置 SO_NOSIGPIPE
+#ifdef MSG_NOSIGNAL
+    static constexpr int SEND_FLAGS = MSG_NOSIGNAL;
+#else
+    static constexpr int SEND_FLAGS = 0;
+#endif
+
+    static int openListener(uint16_t port) {
+        int fd = ::socket(AF_INET, SOCK_STREAM, 0);
+        if (fd < 0) {
+            throw std::runtime_error(std::string("metrics socket failed: ") + std::strerror(errno));
+        }
+        int reuse = 1;
+        ::setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &reuse, sizeof(reuse));
+        sockaddr_in address{};
+        address.sin_family = AF_INET;
+        address.sin_port = htons(port);
+        address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+        if (::bind(fd, reinterpret_cast<sockaddr *>(&address), sizeof(address)) != 0 || ::listen(fd, 16) != 0) {
+            std::string error = std::strerror(errno);
+            ::close(fd);
+            throw std::runtime_error("metrics endpoint on port " + std::to_string(port) + " failed: " + error);
+        }
+        return fd;
+    }
+
+    void exportLoop() {
+        auto nextWrite = std::chrono::steady_clock::now();
+        while (running.load(std::memory_order_acquire)) {
+            auto now = std::chrono::steady_clock::now();
+            if (now >= nextWrite) {
+                writeFile();
+                nextWrite = now + config.interval;
+            }
+            auto untilWrite = std::chrono::duration_cast<std::chrono::milliseconds>(nextWrite - now).count();
+            int timeout = static_cast<int>(std::clamp<long long>(untilWrite, 1, POLL_MILLIS));
+            if (listenFd < 0) {
+                std::this_thread::sleep_for(std::chrono::milliseconds(timeout));
+                continue;
+            }
+            pollfd listener{listenFd, POLLIN, 0};
+            if (::poll(&listener, 1, timeout) > 0 && (listener.revents & POLLIN)) {
+                serveOne();
+            }
+        }
+    }
+
+    void writeFile() {
+        if (config.file.empty()) {
+            return;
+        }
+        std::string temporary = config.file + ".tmp";
+        {
+            std::ofstream out(temporary, std::ios::trunc);
+            if (!out) {
+                return;
+            }
+            out << registry.prometheusText();
+        }
+        std::rename(temporary.c_str(), config.file.c_str());
+    }
+
+    // 读取请求头后返回全部指标并关闭连接；只监听本机地址，不做路由和鉴权
+    void serveOne() {
+        int client = ::accept(listenFd, nullptr, nullptr);
+        if (client < 0) {
+            return;
+        }
+#ifdef SO_NOSIGPIPE
+        int noSigpipe = 1;
+        ::setsockopt(client, SOL_SOCKET, SO_NOSIGPIPE, &noSigpipe, sizeof(noSigpipe));
+#endif
+        char request[1024];
+        pollfd readable{client, POLLIN, 0};
+        if (::poll(&readable, 1, POLL_MILLIS) > 0) {
+            ::recv(client, request, sizeof(request), 0);
+        }
+        std::string body = registry.prometheusText();
+        std::string response = "HTTP/1.1 200 OK\r\n"
+                               "Content-Type: text/plain; version=0.0.4\r\n"
+                               "Content-Length: " + std::to_string(body.size()) + "\r\n"
+                               "Connection: close\r\n\r\n" + body;
+        sendAll(client, response);
+        ::close(client);
+    }
+
+    // 非阻塞发送，整个响应最多等 POLL_MILLIS：不读数据的抓取方不会卡住导出线程和析构时的 join
+    static void sendAll(int client, const std::string &response) {
+        int flags = ::fcntl(client, F_GETFL, 0);
+        if (flags < 0 || ::fcntl(client, F_SETFL, flags | O_NONBLOCK) != 0) {
+            return;
+        }
+        auto deadline = std::chrono::steady_clock::now() + std::chrono::milliseconds(POLL_MILLIS);
+        size_t sent = 0;
+        while (sent < response.size()) {
+            ssize_t n = ::send(client, response.data() + sent, response.size() - sent, SEND_FLAGS);
+            if (n > 0) {
+                sent += static_cast<size_t>(n);
+                continue;
+            }
+            if (n < 0 && errno == EINTR) {
+                continue;
+            }
+            if (n == 0 || (errno != EAGAIN && errno != EWOULDBLOCK)) {
+                return;
+            }
+            auto remaining = std::chrono::duration_cast<std::chrono::milliseconds>(
+                    deadline - std::chrono::steady_clock::now()).count();
+            pollfd writable{client, POLLOUT, 0};
+            if (remaining <= 0 || ::poll(&writable, 1, static_cast<int>(remaining)) <= 0) {
+                return;
+            }
+        }
+    }
+
+    MetricsRegistry &registry;
+    const MetricsExportConfig config;
+    int listenFd = -1;
+    std::atomic<bool> running{true};
+    std::thread worker;
+};
+
+#endif //EVENTLOOPMANAGER_METRICSEXPORTER_H
@@ -0,0 +1,26 @@
+#ifndef EVENTLOOPMANAGER_PRIORITY_H
+#define EVENTLOOPMANAGER_PRIORITY_H
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+
+// 消息优先级，数值越小越优先。控制类消息（如 StatusChangeEvent）使用 High，批量数据使用 Normal 或 Low
+enum class Priority : uint8_t {
+    High,
+    Normal,
+    Low
+};
+
+inline constexpr size_t PRIORITY_LEVELS = 3;
+
+// 加权轮询中每个优先级每轮最多连续取出的条数，按 High、Normal、Low 排列
+using PriorityWeights = std::array<uint32_t, PRIORITY_LEVELS>;
+
+inline constexpr PriorityWeights DEFAULT_PRIORITY_WEIGHTS{8, 4, 1};
+
+inline constexpr size_t priorityIndex(Priority priority) {
+    return static_cast<size_t>(priority);
+}
+
+#endif //EVENTLOOPMANAGER_PRIORITY_H
@@ -13,6 +13,10 @@ using EventHandler = std::function<void(std::shared_ptr<Event>)>;
 
 template<typename T>
 using ChannelHandler = std::function<void(T)>;
+template<typename T>
+using SharedChannelHandler = std::function<void(const std::shared_ptr<const T> &)>;
+using ListenerId = uint64_t;
+using EventTypeId = uint32_t;
 
 class Process {
 private:
@@ -23,15 +27,41 @@ public:
 
     explicit Process(const std::string name);
 
-    static void subscribeEvent(const std::string &eventType, const EventHandler &handler);
+    static ListenerId subscribeEvent(const std::string &eventType, const EventHandler &handler);
+
+    // 按驻留后的事件类型编号订阅和发布，编号由 Manager::eventType() 获取
+    static ListenerId subscribeEvent(EventTypeId eventType, const EventHandler &handler);
+
+    static bool unsubscribeEvent(const std::string &eventType, ListenerId id);
+
+    // 高优先级的事件先于已经排队的普通事件处理
+    void publishEvent(const std::string &eventType, std::shared_ptr<Event> event,
+                      Priority priority = Priority::Normal);
 
-    void publishEvent(const std::string &eventType, std::shared_ptr<Event> event);
+    void publishEvent(EventTypeId eventType, std::shared_ptr<Event> event, Priority priority = Priority::Normal);
+
+    template<typename T>
+    ListenerId subscribeChannel(const std::string &channelName, const ChannelHandler<T> &handler);
+
+    // 通过 ChannelKey 订阅，handler 的参数类型必须与通道类型一致，否则编译失败
+    template<typename T>
+    ListenerId subscribeChannel(const ChannelKey<T> &key, const std::type_identity_t<ChannelHandler<T>> &handler);
 
+    // 广播订阅：多个订阅者共享同一份只读数据，不产生拷贝
     template<typename T>
-    void subscribeChannel(const std::string &channelName, const ChannelHandler<T> &handler);
+    ListenerId subscribeBroadcast(const ChannelKey<T> &key,
+                                  const std::type_identity_t<SharedChannelHandler<T>> &handler);
 
+    static bool unsubscribeChannel(const std::string &channelName, ListenerId id);
+
+    // 右值数据会一路移动到监听器，不产生拷贝
+    // 通道满时的处理方式由通道的 BackpressurePolicy 决定，结果通过返回值告知
+    // priority 只对启用了优先级子队列的通道生效
     template<typename T>
-    void sendtoChannel(const std::string &channelName, const T &data);
+    SendStatus sendtoChannel(const std::string &channelName, T &&data, Priority priority = Priority::Normal);
+
+    template<typename T, typename U>
+    SendStatus sendtoChannel(const ChannelKey<T> &key, U &&data, Priority priority = Priority::Normal);
 };
 
 // Process类的默认构造函数
@@ -40,29 +70,68 @@ inline Process::Process() : name("Unnamed") { }
 // Process类的带参数构造函数
 inline Process::Process(const std::string name) : name(name) {}
 
-void Process::subscribeEvent(const std::string &eventType, const EventHandler &handler) {
+ListenerId Process::subscribeEvent(const std::string &eventType, const EventHandler &handler) {
+    Manager &manager = Manager::getInstance();
+    return manager.subscribeEvent(eventType, handler);
+}
+
+ListenerId Process::subscribeEvent(EventTypeId eventType, const EventHandler &handler) {
+    Manager &manager = Manager::getInstance();
+    return manager.subscribeEvent(eventType, handler);
+}
+
+bool Process::unsubscribeEvent(const std::string &eventType, ListenerId id) {
     Manager &manager = Manager::getInstance();
-    manager.subscribeEvent(eventType, handler);
+    return manager.unsubscribeEvent(eventType, id);
 }
 
-void Process::publishEvent(const std::string &eventType, std::shared_ptr<Event> event) {
+bool Process::unsubscribeChannel(const std::string &channelName, ListenerId id) {
     Manager &manager = Manager::getInstance();
-    manager.publishEvent(eventType, event);
+    return manager.unsubscribeChannel(channelName, id);
+}
+
+void Process::publishEvent(const std::string &eventType, std::shared_ptr<Event> event, Priority priority) {
+    Manager &manager = Manager::getInstance();
+    manager.publishEvent(eventType, event, priority);
+}
+
+void Process::publishEvent(EventTypeId eventType, std::shared_ptr<Event> event, Priority priority) {
+    Manager &manager = Manager::getInstance();
+    manager.publishEvent(eventType, std::move(event), priority);
 }
 
 // 订阅channel
 // 通过Manager类的getOrCreateChannel方法获取或创建Channel对象，然后创建一个任务，该任务从Channel对象中接收数据并调用handler函数处理数据
 template<typename T>
-void Process::subscribeChannel(const std::string &channelName, const ChannelHandler<T>& handler) {
+ListenerId Process::subscribeChannel(const std::string &channelName, const ChannelHandler<T>& handler) {
     Manager& manager = Manager::getInstance();
-    manager.subscribeChannel(channelName, handler);
+    return manager.subscribeChannel(channelName, handler);
+}
+
+template<typename T>
+ListenerId Process::subscribeChannel(const ChannelKey<T> &key,
+                                     const std::type_identity_t<ChannelHandler<T>> &handler) {
+    Manager &manager = Manager::getInstance();
+    return manager.subscribeChannel(key, handler);
 }
 
+template<typename T>
+ListenerId Process::subscribeBroadcast(const ChannelKey<T> &key,
+                                       const std::type_identity_t<SharedChannelHandler<T>> &handler) {
+    Manager &manager = Manager::getInstance();
+    return manager.subscribeBroadcast(key, handler);
+}
 
 template<typename T>
-void Process::sendtoChannel(const std::string &channelName, const T &data) {
+SendStatus Process::sendtoChannel(const std::string &channelName, T &&data, Priority priority) {
+    Manager &manager = Manager::getInstance();
+    return manager.publishToChannel(channelName, std::forward<T>(data), priority);
+}
+
+template<typename T, typename U>
+SendStatus Process::sendtoChannel(const ChannelKey<T> &key, U &&data, Priority priority) {
     Manager &manager = Manager::getInstance();
-    manager.publishToChannel(channelName, data);
+    return manager.publishToChannel(key, std::forward<U>(data), priority);
 }
 
 #endif // PROCESS_H
@@ -1,16 +1,14 @@
 #ifndef PRODUCER_H
 #define PRODUCER_H
 
-#include <iostream>
 #include <random>
-#include <thread>
 #include <string>
-#include "rapidjson/document.h"
-#include "rapidjson/writer.h"
-#include "rapidjson/stringbuffer.h"
+#include "Logger.h"
 #include "Manager.h"
 #include "Process.h"
+#include "ChannelKeys.h"
 #include "SensorReader.h"
+#include "SensorReading.h"
 
 class Producer {
 public:
@@ -21,52 +19,80 @@ public:
     Producer &operator=(Producer &&producer) = default;
     ~Producer();
 
+    // 开始产生数据：读数由 Manager 的定时器按随机间隔触发，不占用单独的线程，函数立即返回。
+    // 定时器回调持有 this，产生数据期间 Producer 不能移动或销毁
     void produceData() {
-        Process process(producerName);
-
-        for (int i = 1; i <= 10; ++i) {
-            rapidjson::Document doc;
-            doc.SetObject();
-            rapidjson::Document::AllocatorType &allocator = doc.GetAllocator();
-
-            // 读取传感器数据
-            double temperature = reader->readTemperature();
-            double humidity = reader->readHumidity();
-            double co2Concentration = reader->readCO2Concentration();
-
-            // 构建JSON文档
-            doc.AddMember("id", i, allocator);
-            rapidjson::Value nameValue; // 创建一个空的Value对象
-            nameValue.SetString(producerName.c_str(), allocator); // 设置字符串值
-            doc.AddMember("name", nameValue, allocator); // 添加到文档
-            doc.AddMember("temperature", temperature, allocator);
-            doc.AddMember("humidity", humidity, allocator);
-            doc.AddMember("co2Concentration", co2Concentration, allocator);
-            doc.AddMember("latitude", latitude, allocator);
-            doc.AddMember("longitude", longitude, allocator);
-
-            // 将文档转换为字符串
-            rapidjson::StringBuffer buffer;
-            rapidjson::Writer<rapidjson::StringBuffer> writer(buffer);
-            doc.Accept(writer);
-            std::string jsonData = buffer.GetString();
-
-            // 输出JSON数据到控制台（示例用途）
-            std::cout << producerName << " sends data: " << jsonData << std::endl;
-
-            // 发送数据到"DataChannel"通道
-            process.sendtoChannel("DataChannel", jsonData);
-
-            // 模拟数据产生间隔
-            std::this_thread::sleep_for(std::chrono::milliseconds(generateRandomTime()));
-        }
+        // 句柄只获取一次，之后按编号发布，不再按名字查找通道
+        channel = Manager::getInstance().channel(DATA_CHANNEL);
+        sensorId = SensorRegistry::intern(producerName);
+        readingId = 0;
+        scheduleNextReading(std::chrono::milliseconds(generateRandomTime()));
     }
 
 private:
+    static constexpr int READINGS = 10;
+
+    // 分片模式下读数在生产者名字所在的分片上产生，否则在事件循环上产生
+    void scheduleNextReading(std::chrono::milliseconds delay) {
+        Manager &manager = Manager::getInstance();
+        if (manager.shardCount() > 0) {
+            manager.shardFor(producerName).scheduleAfter(delay, [this] { produceReading(); });
+        } else {
+            manager.scheduleAfter(delay, [this] { produceReading(); });
+        }
+    }
+
+    // 在定时器线程上执行：产生一条读数并发送，然后安排下一次读数
+    void produceReading() {
+        // DataChannel 或消费者的收件箱积压超过高水位时暂停生产，稍后再试，等积压回落到低水位以下
+        if (channel.isThrottled(producerName)) {
+            if (!throttled) {
+                LOG_WARN(producerName, " throttled: DataChannel backpressure");
+                throttled = true;
+            }
+            scheduleNextReading(std::chrono::milliseconds(10));
+            return;
+        }
+        throttled = false;
+
+        int i = ++readingId;
+
+        // 读取传感器数据，直接填入定长的读数记录
+        SensorReading reading;
+        reading.timestampNanos = std::chrono::duration_cast<std::chrono::nanoseconds>(
+                std::chrono::system_clock::now().time_since_epoch()).count();
+        reading.id = static_cast<uint32_t>(i);
+        reading.sensor = sensorId;
+        reading.temperature = reader->readTemperature();
+        reading.humidity = reader->readHumidity();
+        reading.co2Concentration = reader->readCO2Concentration();
+        reading.latitude = latitude;
+        reading.longitude = longitude;
+
+        // 记录读数（示例用途），默认的 Info 级别下不输出
+        LOG_DEBUG(producerName, " sends reading ", i, ": temperature ", reading.temperature,
+                  ", humidity ", reading.humidity);
+
+        // 发送数据到"DataChannel"通道，以生产者名字为路由键：同一个传感器的数据总在同一个分片上按顺序处理
+        SendStatus status = channel.publish(producerName, reading);
+        if (status != SendStatus::Ok) {
+            LOG_WARN(producerName, " data not delivered to DataChannel, status ", static_cast<int>(status));
+        }
+
+        // 模拟数据产生间隔
+        if (i < READINGS) {
+            scheduleNextReading(std::chrono::milliseconds(generateRandomTime()));
+        }
+    }
+
     std::string producerName;
     std::unique_ptr<SensorReader> reader;
     double latitude; // 生产者的纬度
     double longitude; // 生产者的经度
+    ChannelHandle<SensorReading> channel;
+    SensorId sensorId = 0;
+    int readingId = 0;
+    bool throttled = false;
 
     // 生成随机时间，假设在100到500毫秒之间
     static int generateRandomTime() {
@@ -85,7 +111,7 @@ Producer::Producer(const std::string &name, double latitude, double longitude) {
 }
 
 Producer::~Producer() {
-    std::cout << "Producer" << producerName <<" is destroyed." << std::endl;
+    LOG_DEBUG("Producer ", producerName, " is destroyed.");
 }
 
 #endif //PRODUCER_H
\ No newline at end of file
@@ -4,6 +4,7 @@
 #include <fstream>
 #include <vector>
 #include "rapidjson/document.h"
+#include "Logger.h"
 
 
 class ProducerConfig {
@@ -20,9 +21,10 @@ public:
         }
         std::string content((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
 
+        // 原地解析：字符串值直接指向 content，不再复制
         rapidjson::Document doc;
-        if (doc.Parse(content.c_str()).HasParseError()) {
-            std::cerr << "Error parsing JSON." << std::endl;
+        if (doc.ParseInsitu(content.data()).HasParseError()) {
+            LOG_ERROR("Error parsing JSON: ", filePath);
             return configs; // 或者是其他错误处理方式
         }
         const auto& producers = doc["producers"].GetArray();
@@ -0,0 +1,235 @@
+#ifndef EVENTLOOPMANAGER_REACTOR_H
+#define EVENTLOOPMANAGER_REACTOR_H
+
+#include <array>
+#include <atomic>
+#include <mutex>
+#include <optional>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+#include "EventCount.h"
+#include "Logger.h"
+#include "Priority.h"
+#include "Task.h"
+#include "TaskNodePool.h"
+#include "ThreadPlacement.h"
+#include "TimerWheel.h"
+
+/*
+ * 单线程反应器：分片模式下 Manager 的一个分片。
+ * 每个反应器有自己的线程、邮箱和定时器轮，提交到同一个反应器的任务按提交顺序在同一个线程上执行，
+ * 所以按路由键分到同一分片的状态不需要加锁。
+ *  - 邮箱是无锁的多生产者单消费者栈：post() 用一次 CAS 压入，反应器线程用一次 exchange 整体取走再反转为 FIFO；
+ *    每个优先级一个邮箱，每一轮先执行高优先级邮箱中的全部任务；
+ *  - 任务节点来自 TaskNodePool，稳定状态下 post() 不分配内存；
+ *  - 没有任务和到期定时器时线程在 EventCount 上睡眠，不轮询。
+ */
+class Reactor {
+public:
+    // cpu >= 0 时把反应器线程绑定到该 CPU（仅 Linux）；name 非空时设置线程名
+    explicit Reactor(size_t index, int cpu = -1, const std::string &name = {}) : shardIndex(index) {
+        thread = std::thread([this, cpu, name] {
+            ThreadPlacement::applyToCurrentThread(cpu, name);
+            loop();
+        });
+    }
+
+    Reactor(const Reactor &) = delete;
+    Reactor &operator=(const Reactor &) = delete;
+
+    ~Reactor() {
+        stop();
+    }
+
+    // 提交任务，可以在任意线程调用；反应器停止后抛出 std::runtime_error
+    template<typename F>
+    void post(F &&f, Priority priority = Priority::Normal) {
+        if (stopping.load(std::memory_order_acquire)) {
+            throw std::runtime_error("post on stopped Reactor");
+        }
+        TaskNode *node = TaskNodePool::allocate();
+        node->task.emplace(std::forward<F>(f));
+        std::atomic<TaskNode *> &mailbox = mailboxes[priorityIndex(priority)];
+        TaskNode *head = mailbox.load(std::memory_order_relaxed);
+        do {
+            node->next = head;
+        } while (!mailbox.compare_exchange_weak(head, node, std::memory_order_release, std::memory_order_relaxed));
+        wakeup.notifyOne();
+    }
+
+    // 定时器回调在反应器线程上执行
+    TimerWheel::TimerId scheduleAfter(TimerWheel::Clock::duration delay, Task callback) {
+        return scheduleTimer(TimerWheel::Clock::now() + delay, TimerWheel::Clock::duration::zero(), std::move(callback));
+    }
+
+    TimerWheel::TimerId scheduleEvery(TimerWheel::Clock::duration period, Task callback) {
+        if (period <= TimerWheel::Clock::duration::zero()) {
+            throw std::invalid_argument("timer period must be positive");
+        }
+        return scheduleTimer(TimerWheel::Clock::now() + period, period, std::move(callback));
+    }
+
+    bool cancel(TimerWheel::TimerId id) {
+        std::lock_guard<std::mutex> lock(timerMutex);
+        return timers.cancel(id);
+    }
+
+    // 当前线程是否是这个反应器的线程
+    bool inReactor() const {
+        return current == this;
+    }
+
+    size_t index() const {
+        return shardIndex;
+    }
+
+    // 停止并等待线程退出；已经提交的任务会先执行完，尚未到期的定时器不再执行
+    void stop() {
+        if (!stopping.exchange(true, std::memory_order_acq_rel)) {
+            wakeup.notifyAll();
+        }
+        if (thread.joinable() && !inReactor()) {
+            thread.join();
+            // 与 stop() 竞争、在线程退出之后才进入邮箱的任务不再执行
+            discardMailboxes();
+        }
+    }
+
+private:
+    TimerWheel::TimerId scheduleTimer(TimerWheel::Clock::time_point when, TimerWheel::Clock::duration period,
+                                      Task callback) {
+        TimerWheel::TimerId id;
+        {
+            std::lock_guard<std::mutex> lock(timerMutex);
+            id = timers.schedule(when, period, std::move(callback));
+        }
+        // 反应器线程可能正按更晚的到期时间睡眠
+        if (!inReactor()) {
+            timersChanged.store(true, std::memory_order_seq_cst);
+            wakeup.notifyOne();
+        }
+        return id;
+    }
+
+    // 按优先级依次取走各邮箱中的全部任务并按提交顺序执行
+    void runMailboxes() {
+        for (auto &mailbox: mailboxes) {
+            runMailbox(mailbox);
+        }
+    }
+
+    void runMailbox(std::atomic<TaskNode *> &mailbox) {
+        TaskNode *node = mailbox.exchange(nullptr, std::memory_order_acquire);
+        TaskNode *ordered = nullptr;
+        while (node) {
+            TaskNode *next = node->next;
+            node->next = ordered;
+            ordered = node;
+            node = next;
+        }
+        while (ordered) {
+            TaskNode *next = ordered->next;
+            try {
+                ordered->task();
+            } catch (const std::exception &e) {
+                LOG_ERROR("Reactor ", shardIndex, " task threw: ", e.what());
+            } catch (...) {
+                LOG_ERROR("Reactor ", shardIndex, " task threw an unknown exception");
+            }
+            TaskNodePool::release(ordered);
+            ordered = next;
+        }
+    }
+
+    bool mailboxesEmpty() const {
+        for (auto &mailbox: mailboxes) {
+            if (mailbox.load(std::memory_order_seq_cst) != nullptr) {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    void discardMailboxes() {
+        for (auto &mailbox: mailboxes) {
+            TaskNode *node = mailbox.exchange(nullptr, std::memory_order_acquire);
+            while (node) {
+                TaskNode *next = node->next;
+                TaskNodePool::release(node);
+                node = next;
+            }
+        }
+    }
+
+    // 推进定时器轮并执行到期的回调，返回下一次到期时间
+    std::optional<TimerWheel::Clock::time_point> runTimers() {
+        {
+            std::lock_guard<std::mutex> lock(timerMutex);
+            timers.advance(TimerWheel::Clock::now(), expiredTimers);
+        }
+        for (auto &timer: expiredTimers) {
+            if (timer->cancelled.load(std::memory_order_relaxed)) {
+                continue;
+            }
+            try {
+                timer->callback();
+            } catch (const std::exception &e) {
+                LOG_ERROR("Reactor ", shardIndex, " timer callback threw: ", e.what());
+            } catch (...) {
+                LOG_ERROR("Reactor ", shardIndex, " timer callback threw an unknown exception");
+            }
+        }
+        expiredTimers.clear();
+        std::lock_guard<std::mutex> lock(timerMutex);
+        return timers.nextExpiry();
+    }
+
+    void loop() {
+        current = this;
+        while (true) {
+            runMailboxes();
+            auto next = runTimers();
+
+            auto key = wakeup.prepareWait();
+            if (!mailboxesEmpty()
+                || timersChanged.exchange(false, std::memory_order_seq_cst)) {
+                wakeup.cancelWait();
+                continue;
+            }
+            if (stopping.load(std::memory_order_seq_cst)) {
+                wakeup.cancelWait();
+                break;
+            }
+            if (next) {
+                if (*next <= TimerWheel::Clock::now()) {
+                    wakeup.cancelWait();
+                } else {
+                    wakeup.waitUntil(key, *next);
+                }
+            } else {
+                wakeup.wait(key);
+            }
+        }
+        // 停止前提交的任务仍然执行完
+        runMailboxes();
+    }
+
+    const size_t shardIndex;
+    std::array<std::atomic<TaskNode *>, PRIORITY_LEVELS> mailboxes{};
+    EventCount wakeup;
+    std::atomic<bool> stopping{false};
+
+    std::mutex timerMutex;
+    TimerWheel timers;
+    // 其他线程加入了定时器，睡眠前需要重新计算到期时间
+    std::atomic<bool> timersChanged{false};
+    std::vector<std::shared_ptr<TimerWheel::Timer>> expiredTimers;
+
+    std::thread thread;
+
+    inline static thread_local Reactor *current = nullptr;
+};
+
+#endif //EVENTLOOPMANAGER_REACTOR_H
@@ -0,0 +1,87 @@
+#ifndef EVENTLOOPMANAGER_SENSORREADING_H
+#define EVENTLOOPMANAGER_SENSORREADING_H
+
+#include <chrono>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <type_traits>
+#include "InternTable.h"
+#include "JsonContext.h"
+
+// 驻留后的传感器名编号，由 SensorRegistry::intern() 分配
+using SensorId = uint32_t;
+
+// 传感器名的驻留表：读数中只保存编号，需要名字时（路由、序列化）按编号取回，不加锁
+class SensorRegistry {
+public:
+    static constexpr size_t MAX_SENSORS = 4096;
+
+    static SensorId intern(std::string_view name) {
+        return table().intern(name, [name] { return std::make_shared<const std::string>(name); });
+    }
+
+    static const std::string &name(SensorId id) {
+        return *table().get(id);
+    }
+
+private:
+    static InternTable<const std::string> &table() {
+        static InternTable<const std::string> sensors(MAX_SENSORS);
+        return sensors;
+    }
+};
+
+/*
+ * 一条传感器读数。定长、可平凡复制，在通道中按值传递，中途不构造 JSON DOM，也不解析文本；
+ * 只在 Kafka 出口处用 toJson() 序列化一次。
+ */
+struct SensorReading {
+    // system_clock 纪元以来的纳秒
+    int64_t timestampNanos = 0;
+    double latitude = 0;
+    double longitude = 0;
+    uint32_t id = 0;
+    SensorId sensor = 0;
+    float temperature = 0;
+    float humidity = 0;
+    float co2Concentration = 0;
+
+    const std::string &sensorName() const {
+        return SensorRegistry::name(sensor);
+    }
+};
+
+static_assert(std::is_trivially_copyable_v<SensorReading>, "SensorReading must stay trivially copyable");
+
+// 与原来 Producer 生成的 JSON 字段相同，另加 timestamp（毫秒）。直接用 Writer 输出，不构造 DOM
+template<typename Writer>
+void writeJson(const SensorReading &reading, Writer &writer) {
+    const std::string &name = reading.sensorName();
+    writer.StartObject();
+    writer.Key("id");
+    writer.Uint(reading.id);
+    writer.Key("name");
+    writer.String(name.data(), static_cast<rapidjson::SizeType>(name.size()));
+    writer.Key("temperature");
+    writer.Double(reading.temperature);
+    writer.Key("humidity");
+    writer.Double(reading.humidity);
+    writer.Key("co2Concentration");
+    writer.Double(reading.co2Concentration);
+    writer.Key("latitude");
+    writer.Double(reading.latitude);
+    writer.Key("longitude");
+    writer.Double(reading.longitude);
+    writer.Key("timestamp");
+    writer.Int64(reading.timestampNanos / 1000000);
+    writer.EndObject();
+}
+
+// 序列化到当前线程的 JsonContext，不分配内存；结果在本线程下一次使用 JsonContext 之前有效
+inline std::string_view toJson(const SensorReading &reading) {
+    return JsonContext::local().write([&](auto &writer) { writeJson(reading, writer); });
+}
+
+#endif //EVENTLOOPMANAGER_SENSORREADING_H
@@ -7,7 +7,7 @@
 #include "Event.h"
 
 // 自定义事件类型
-class StatusChangeEvent : public Event {
+class StatusChangeEvent : public TypedEvent<StatusChangeEvent> {
 public:
     std::string status;
 
@@ -0,0 +1,144 @@
+#ifndef EVENTLOOPMANAGER_STRAND_H
+#define EVENTLOOPMANAGER_STRAND_H
+
+#include <algorithm>
+#include <atomic>
+#include <functional>
+#include <memory>
+#include <string_view>
+#include <vector>
+#include "Logger.h"
+#include "Task.h"
+#include "TaskNodePool.h"
+#include "ThreadPool.h"
+
+/*
+ * 串行执行器（strand）：提交到同一个 strand 的任务在线程池上按提交顺序逐个执行，
+ * 任意时刻最多只有一个在运行；不同 strand 的任务并行执行。没有专用线程，也不加锁：
+ *  - 提交用一次 CAS 压入无锁栈，执行时用一次 exchange 整体取走再反转为 FIFO（与 Reactor 的邮箱相同）；
+ *  - pending 计数从 0 变为 1 的提交者负责把 strand 投递到线程池；
+ *  - 每次最多连续执行 STRAND_BATCH 个任务，还有剩余时重新投递，其他 strand 不会被饿死。
+ * 任务节点来自 TaskNodePool，稳定状态下 post() 不分配内存。
+ * strand 必须活得比提交给它的任务长。
+ */
+class Strand {
+public:
+    static constexpr size_t STRAND_BATCH = 64;
+
+    explicit Strand(ThreadPool &pool) : pool(pool) {}
+
+    Strand(const Strand &) = delete;
+    Strand &operator=(const Strand &) = delete;
+
+    ~Strand() {
+        releaseAll(incoming.exchange(nullptr, std::memory_order_acquire));
+        releaseAll(ready);
+    }
+
+    // 可以在任意线程调用，包括在本 strand 的任务中
+    template<typename F>
+    void post(F &&f) {
+        TaskNode *node = TaskNodePool::allocate();
+        node->task.emplace(std::forward<F>(f));
+        TaskNode *head = incoming.load(std::memory_order_relaxed);
+        do {
+            node->next = head;
+        } while (!incoming.compare_exchange_weak(head, node, std::memory_order_release, std::memory_order_relaxed));
+        // 先入栈再计数：执行端看到的计数总不超过已经入栈的任务数
+        if (pending.fetch_add(1, std::memory_order_acq_rel) == 0) {
+            schedule();
+        }
+    }
+
+    // 当前线程是否正在执行本 strand 的任务
+    bool runningInThisThread() const {
+        return current == this;
+    }
+
+private:
+    void schedule() {
+        pool.post([this] { run(); });
+    }
+
+    void run() {
+        Strand *previous = current;
+        current = this;
+        size_t budget = std::min(pending.load(std::memory_order_acquire), STRAND_BATCH);
+        for (size_t i = 0; i < budget; ++i) {
+            if (!ready) {
+                takeIncoming();
+            }
+            TaskNode *node = ready;
+            ready = node->next;
+            // 任务抛出任何异常都要归还节点并计入 budget，否则这个 strand 不会再被投递，落在它上面的键全部停住
+            try {
+                node->task();
+            } catch (const std::exception &e) {
+                LOG_ERROR("Strand task threw: ", e.what());
+            } catch (...) {
+                LOG_ERROR("Strand task threw an unknown exception");
+            }
+            TaskNodePool::release(node);
+        }
+        current = previous;
+        // 执行期间又有新任务计入时重新投递，由下一次 run() 继续
+        if (pending.fetch_sub(budget, std::memory_order_acq_rel) > budget) {
+            schedule();
+        }
+    }
+
+    // 取走栈中的全部任务，反转为提交顺序接在 ready 之后（调用时 ready 为空）
+    void takeIncoming() {
+        TaskNode *node = incoming.exchange(nullptr, std::memory_order_acquire);
+        while (node) {
+            TaskNode *next = node->next;
+            node->next = ready;
+            ready = node;
+            node = next;
+        }
+    }
+
+    static void releaseAll(TaskNode *node) {
+        while (node) {
+            TaskNode *next = node->next;
+            TaskNodePool::release(node);
+            node = next;
+        }
+    }
+
+    ThreadPool &pool;
+    std::atomic<TaskNode *> incoming{nullptr};
+    // 已经取出、按提交顺序排好但尚未执行的任务，只在 run() 中访问
+    TaskNode *ready = nullptr;
+    std::atomic<size_t> pending{0};
+
+    inline static thread_local Strand *current = nullptr;
+};
+
+/*
+ * 按键选择 strand：同一个键（例如生产者名）总是落在同一个 strand 上，任务按提交顺序执行；
+ * 不同的键分散到不同的 strand 上并行执行。strand 的数量固定，不同的键也可能落在同一个 strand 上，
+ * 这时它们之间只是失去并行，顺序仍然保证。查找是一次哈希取模，不加锁。
+ */
+class StrandGroup {
+public:
+    StrandGroup(ThreadPool &pool, size_t count) {
+        strands.reserve(std::max<size_t>(1, count));
+        for (size_t i = 0; i < std::max<size_t>(1, count); ++i) {
+            strands.push_back(std::make_unique<Strand>(pool));
+        }
+    }
+
+    Strand &strandFor(std::string_view key) {
+        return *strands[std::hash<std::string_view>{}(key) % strands.size()];
+    }
+
+    size_t size() const {
+        return strands.size();
+    }
+
+private:
+    std::vector<std::unique_ptr<Strand>> strands;
+};
+
+#endif //EVENTLOOPMANAGER_STRAND_H
@@ -0,0 +1,119 @@
+#ifndef EVENTLOOPMANAGER_TASK_H
+#define EVENTLOOPMANAGER_TASK_H
+
+#include <cstddef>
+#include <functional>
+#include <new>
+#include <type_traits>
+#include <utility>
+
+/*
+ * 只能移动的 void() 可调用对象，带小对象缓冲区（small-buffer storage）。
+ * 与 std::function 相比：
+ *  - 不要求可调用对象可拷贝，可以直接保存 std::packaged_task、持有 unique_ptr 的 lambda 等；
+ *  - 不超过 INLINE_SIZE 字节、且移动构造不抛异常的可调用对象直接存放在内部缓冲区，不分配堆内存。
+ */
+class Task {
+public:
+    static constexpr size_t INLINE_SIZE = 48;
+
+    Task() noexcept = default;
+
+    template<typename F,
+            typename = std::enable_if_t<!std::is_same_v<std::decay_t<F>, Task> &&
+                                        std::is_invocable_v<std::decay_t<F> &>>>
+    Task(F &&f) {
+        emplace(std::forward<F>(f));
+    }
+
+    Task(Task &&other) noexcept {
+        moveFrom(other);
+    }
+
+    Task &operator=(Task &&other) noexcept {
+        if (this != &other) {
+            reset();
+            moveFrom(other);
+        }
+        return *this;
+    }
+
+    Task(const Task &) = delete;
+    Task &operator=(const Task &) = delete;
+
+    ~Task() {
+        reset();
+    }
+
+    template<typename F>
+    void emplace(F &&f) {
+        using Fn = std::decay_t<F>;
+        reset();
+        if constexpr (fitsInline<Fn>()) {
+            new(storage) Fn(std::forward<F>(f));
+            ops = &inlineOps<Fn>;
+        } else {
+            new(storage) Fn *(new Fn(std::forward<F>(f)));
+            ops = &heapOps<Fn>;
+        }
+    }
+
+    void operator()() {
+        ops->invoke(storage);
+    }
+
+    explicit operator bool() const noexcept {
+        return ops != nullptr;
+    }
+
+    void reset() noexcept {
+        if (ops) {
+            ops->destroy(storage);
+            ops = nullptr;
+        }
+    }
+
+private:
+    struct Ops {
+        void (*invoke)(void *self);
+        void (*move)(void *dst, void *src) noexcept;
+        void (*destroy)(void *self) noexcept;
+    };
+
+    template<typename Fn>
+    static constexpr bool fitsInline() {
+        return sizeof(Fn) <= INLINE_SIZE && alignof(Fn) <= alignof(std::max_align_t) &&
+               std::is_nothrow_move_constructible_v<Fn>;
+    }
+
+    template<typename Fn>
+    static constexpr Ops inlineOps{
+            [](void *self) { std::invoke(*static_cast<Fn *>(self)); },
+            [](void *dst, void *src) noexcept {
+                new(dst) Fn(std::move(*static_cast<Fn *>(src)));
+                static_cast<Fn *>(src)->~Fn();
+            },
+            [](void *self) noexcept { static_cast<Fn *>(self)->~Fn(); }
+    };
+
+    // 放不进缓冲区的可调用对象放在堆上，缓冲区里只保存指针
+    template<typename Fn>
+    static constexpr Ops heapOps{
+            [](void *self) { std::invoke(**static_cast<Fn **>(self)); },
+            [](void *dst, void *src) noexcept { new(dst) Fn *(*static_cast<Fn **>(src)); },
+            [](void *self) noexcept { delete *static_cast<Fn **>(self); }
+    };
+
+    void moveFrom(Task &other) noexcept {
+        if (other.ops) {
+            other.ops->move(storage, other.storage);
+            ops = other.ops;
+            other.ops = nullptr;
+        }
+    }
+
+    alignas(std::max_align_t) unsigned char storage[INLINE_SIZE];
+    const Ops *ops = nullptr;
+};
+
+#endif //EVENTLOOPMANAGER_TASK_H
@@ -0,0 +1,120 @@
+#ifndef EVENTLOOPMANAGER_TASKNODEPOOL_H
+#define EVENTLOOPMANAGER_TASKNODEPOOL_H
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include "Task.h"
+
+class TaskNodePool;
+
+// 线程池中流转的任务节点，由 TaskNodePool 分配和回收
+struct TaskNode {
+    Task task;
+    TaskNode *next = nullptr;
+    TaskNodePool *owner = nullptr;
+    // 采样到的提交时间（metricsNow()），0 表示这个任务不统计排队时间
+    int64_t enqueuedNanos = 0;
+};
+
+/*
+ * 每个线程一个的任务节点池。
+ * 节点由提交任务的线程分配，通常在工作线程上执行完之后释放：
+ *  - 在分配它的线程上释放时，直接放回该线程的本地空闲链表（无任何同步）；
+ *  - 在其他线程上释放时，用一次 CAS 压入所属池的 remoteFree 栈，
+ *    所属线程在本地链表用完时用一次 exchange 整体取回。
+ * 稳定状态下提交与执行任务都不会调用 malloc。
+ *
+ * 池的生命周期由引用计数管理：所属线程持有一个引用，每个尚未归还的节点各持有一个引用。
+ * 线程退出后，最后一个归还节点的线程负责释放池本身。
+ */
+class TaskNodePool {
+public:
+    // 从当前线程的池中取一个空节点
+    static TaskNode *allocate() {
+        TaskNodePool *pool = current();
+        TaskNode *node = pool->localFree;
+        if (!node) {
+            node = pool->remoteFree.exchange(nullptr, std::memory_order_acquire);
+        }
+        if (node) {
+            pool->localFree = node->next;
+        } else {
+            node = new TaskNode;
+        }
+        node->next = nullptr;
+        node->owner = pool;
+        pool->refs.fetch_add(1, std::memory_order_relaxed);
+        return node;
+    }
+
+    // 销毁节点中的任务并把节点还给所属的池，可以在任意线程调用
+    static void release(TaskNode *node) noexcept {
+        node->task.reset();
+        TaskNodePool *owner = node->owner;
+        if (owner == currentPool) {
+            node->next = owner->localFree;
+            owner->localFree = node;
+            owner->refs.fetch_sub(1, std::memory_order_relaxed);
+            return;
+        }
+        TaskNode *head = owner->remoteFree.load(std::memory_order_relaxed);
+        do {
+            node->next = head;
+        } while (!owner->remoteFree.compare_exchange_weak(head, node, std::memory_order_release,
+                                                          std::memory_order_relaxed));
+        owner->unref();
+    }
+
+private:
+    TaskNodePool() = default;
+
+    ~TaskNodePool() {
+        freeList(localFree);
+        freeList(remoteFree.exchange(nullptr, std::memory_order_acquire));
+    }
+
+    static void freeList(TaskNode *node) noexcept {
+        while (node) {
+            TaskNode *next = node->next;
+            delete node;
+            node = next;
+        }
+    }
+
+    void unref() noexcept {
+        if (refs.fetch_sub(1, std::memory_order_acq_rel) == 1) {
+            delete this;
+        }
+    }
+
+    inline static thread_local TaskNodePool *currentPool = nullptr;
+
+    TaskNode *localFree = nullptr;
+    std::atomic<TaskNode *> remoteFree{nullptr};
+    std::atomic<size_t> refs{1};
+
+    // 线程退出时释放空闲节点并放弃线程持有的引用
+    struct ThreadHolder {
+        TaskNodePool *pool;
+
+        ThreadHolder() : pool(new TaskNodePool) {
+            currentPool = pool;
+        }
+
+        ~ThreadHolder() {
+            currentPool = nullptr;
+            freeList(pool->localFree);
+            pool->localFree = nullptr;
+            freeList(pool->remoteFree.exchange(nullptr, std::memory_order_acquire));
+            pool->unref();
+        }
+    };
+
+    static TaskNodePool *current() {
+        static thread_local ThreadHolder holder;
+        return holder.pool;
+    }
+};
+
+#endif //EVENTLOOPMANAGER_TASKNODEPOOL_H
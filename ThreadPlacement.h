@@ -0,0 +1,185 @@
+#ifndef EVENTLOOPMANAGER_THREADPLACEMENT_H
+#define EVENTLOOPMANAGER_THREADPLACEMENT_H
+
+#include <algorithm>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+#if defined(__linux__) || defined(__APPLE__)
+#include <pthread.h>
+#endif
+#ifdef __linux__
+#include <sched.h>
+#endif
+
+// 线程绑核策略
+enum class PinningStrategy {
+    // 不绑定，由操作系统调度
+    None,
+    // 依次占满一个 NUMA 节点的 CPU 再使用下一个节点，线程之间共享缓存，适合通信密集的线程组
+    Compact,
+    // 线程轮流分布到各个 NUMA 节点，每个节点的内存带宽都能用上
+    Scatter,
+    // 使用 cpus 中给出的 CPU，按线程编号循环使用
+    Explicit
+};
+
+/*
+ * 一组线程的放置方式：绑核策略和线程名。
+ *  - 只在进程允许使用的 CPU（sched_getaffinity，受 taskset / cgroup 限制）中选择；
+ *  - NUMA 拓扑从 /sys/devices/system/node 读取，读不到时把所有 CPU 视为一个节点；
+ *  - 线程名为“前缀-编号”，在 top -H、perf、gdb 中可见（Linux 上最长 15 个字符，超出部分被截断）。
+ * 绑核只在 Linux 上生效；macOS 只设置线程名。
+ *
+ * NUMA 本地内存依靠操作系统默认的 first-touch 策略：线程先绑核，再在自己的线程上分配和初始化
+ * 自己的数据结构，这些页就落在该 CPU 所在的节点上，不需要依赖 libnuma。
+ */
+struct ThreadPlacement {
+    PinningStrategy strategy = PinningStrategy::None;
+    // strategy 为 Explicit 时使用的 CPU 编号
+    std::vector<int> cpus;
+    // 线程名前缀，空字符串表示不设置线程名
+    std::string namePrefix;
+
+    // 计算 threads 个线程各自绑定的 CPU，-1 表示不绑定
+    std::vector<int> plan(size_t threads) const {
+        std::vector<int> result(threads, -1);
+        if (strategy == PinningStrategy::None || threads == 0) {
+            return result;
+        }
+        if (strategy == PinningStrategy::Explicit) {
+            for (size_t i = 0; i < threads && !cpus.empty(); ++i) {
+                result[i] = cpus[i % cpus.size()];
+            }
+            return result;
+        }
+        auto nodes = numaNodes();
+        if (nodes.empty()) {
+            return result;
+        }
+        if (strategy == PinningStrategy::Compact) {
+            std::vector<int> ordered;
+            for (auto &node: nodes) {
+                ordered.insert(ordered.end(), node.begin(), node.end());
+            }
+            for (size_t i = 0; i < threads; ++i) {
+                result[i] = ordered[i % ordered.size()];
+            }
+        } else {
+            for (size_t i = 0; i < threads; ++i) {
+                auto &node = nodes[i % nodes.size()];
+                result[i] = node[(i / nodes.size()) % node.size()];
+            }
+        }
+        return result;
+    }
+
+    // 第 index 个线程的线程名
+    std::string threadName(size_t index) const {
+        if (namePrefix.empty()) {
+            return {};
+        }
+        return namePrefix + "-" + std::to_string(index);
+    }
+
+    // 在新线程开始时调用：先绑核再命名
+    static void applyToCurrentThread(int cpu, const std::string &name) {
+        pinCurrentThread(cpu);
+        nameCurrentThread(name);
+    }
+
+    static void pinCurrentThread(int cpu) {
+#ifdef __linux__
+        if (cpu >= 0) {
+            cpu_set_t set;
+            CPU_ZERO(&set);
+            CPU_SET(cpu, &set);
+            pthread_setaffinity_np(pthread_self(), sizeof(set), &set);
+        }
+#else
+        (void) cpu;
+#endif
+    }
+
+    static void nameCurrentThread(const std::string &name) {
+        if (name.empty()) {
+            return;
+        }
+#if defined(__linux__)
+        pthread_setname_np(pthread_self(), name.substr(0, 15).c_str());
+#elif defined(__APPLE__)
+        pthread_setname_np(name.c_str());
+#endif
+    }
+
+    // 每个 NUMA 节点上进程允许使用的 CPU，去掉没有可用 CPU 的节点
+    static std::vector<std::vector<int>> numaNodes() {
+        std::vector<int> allowed = allowedCpus();
+        std::vector<std::vector<int>> nodes;
+        for (int node = 0;; ++node) {
+            std::ifstream file("/sys/devices/system/node/node" + std::to_string(node) + "/cpulist");
+            if (!file) {
+                break;
+            }
+            std::string list;
+            std::getline(file, list);
+            std::vector<int> cpusOfNode;
+            for (int cpu: parseCpuList(list)) {
+                if (std::find(allowed.begin(), allowed.end(), cpu) != allowed.end()) {
+                    cpusOfNode.push_back(cpu);
+                }
+            }
+            if (!cpusOfNode.empty()) {
+                nodes.push_back(std::move(cpusOfNode));
+            }
+        }
+        if (nodes.empty() && !allowed.empty()) {
+            nodes.push_back(std::move(allowed));
+        }
+        return nodes;
+    }
+
+private:
+    static std::vector<int> allowedCpus() {
+        std::vector<int> result;
+#ifdef __linux__
+        cpu_set_t set;
+        CPU_ZERO(&set);
+        if (sched_getaffinity(0, sizeof(set), &set) == 0) {
+            for (int cpu = 0; cpu < CPU_SETSIZE; ++cpu) {
+                if (CPU_ISSET(cpu, &set)) {
+                    result.push_back(cpu);
+                }
+            }
+            return result;
+        }
+#endif
+        for (unsigned cpu = 0; cpu < std::max(1u, std::thread::hardware_concurrency()); ++cpu) {
+            result.push_back(static_cast<int>(cpu));
+        }
+        return result;
+    }
+
+    // 解析形如 "0-3,8-11" 的 CPU 列表
+    static std::vector<int> parseCpuList(const std::string &list) {
+        std::vector<int> result;
+        std::stringstream stream(list);
+        std::string range;
+        while (std::getline(stream, range, ',')) {
+            if (range.empty()) {
+                continue;
+            }
+            auto dash = range.find('-');
+            int first = std::stoi(range.substr(0, dash));
+            int last = dash == std::string::npos ? first : std::stoi(range.substr(dash + 1));
+            for (int cpu = first; cpu <= last; ++cpu) {
+                result.push_back(cpu);
+            }
+        }
+        return result;
+    }
+};
+
+#endif //EVENTLOOPMANAGER_THREADPLACEMENT_H
@@ -6,18 +6,43 @@
 #define EVENTLOOPMANAGER_THREADPOOL_H
 
 
+#include <atomic>
 #include <vector>
-#include <queue>
 #include <thread>
 #include <mutex>
 #include <condition_variable>
 #include <functional>
 #include <future>
+#include <memory>
 #include <stdexcept>
+#include <latch>
+#include "Logger.h"
+#include "Metrics.h"
+#include "Task.h"
+#include "TaskNodePool.h"
+#include "ThreadPlacement.h"
+#include "WorkStealingDeque.h"
 
+/*
+ * 工作窃取线程池。
+ * 每个工作线程有自己的 Chase-Lev 双端队列：
+ *  - 在工作线程内部提交的任务直接压入本线程的队列，不需要任何锁；
+ *  - 从外部线程提交的任务进入全局注入队列（由 queue_mutex 保护）；
+ *  - 工作线程按“本地队列 -> 全局队列 -> 随机选择其他线程窃取”的顺序取任务。
+ * 只有在所有地方都没有任务时工作线程才会在 condition 上睡眠。
+ *
+ * 任务保存在 TaskNodePool 分配的节点里（只能移动、带小对象缓冲区的 Task），
+ * 通过 post() 提交的任务在稳定状态下不会分配堆内存。
+ *
+ * 构造时可以指定线程的绑核策略和线程名（见 ThreadPlacement）。每个工作线程先绑核，
+ * 再在自己的线程上创建本地队列，队列的内存因此分配在该线程所在的 NUMA 节点上。
+ *
+ * 指标（标签 pool 为线程名前缀）：执行的任务数、排队时间（按 QUEUE_WAIT_SAMPLE 采样，从提交到开始执行）、
+ * 待执行的任务数、线程数和线程累计空闲时间；利用率 = 1 - 空闲时间增量 / (线程数 × 时间窗口)。
+ */
 class ThreadPool {
 public:
-    ThreadPool(size_t);
+    explicit ThreadPool(size_t threads, const ThreadPlacement &placement = ThreadPlacement{});
 
     ~ThreadPool();
 
@@ -26,45 +51,84 @@ public:
     auto enqueue(F&& f, Args&&... args)
     -> std::future<typename std::invoke_result<F, Args...>::type>;
 
+    // 提交不需要返回值的任务（fire-and-forget），不创建 future
+    template<class F>
+    void post(F&& f);
+
+    size_t size() const {
+        return workers.size();
+    }
+
+    // 每提交这么多个任务采样一次排队时间，其余任务不读时钟
+    static constexpr uint32_t QUEUE_WAIT_SAMPLE = 16;
+
 private:
+    static std::string poolLabel(const ThreadPlacement &placement);
+
+    void registerMetrics(const std::string &labels, size_t threads);
+
+    void submit(TaskNode *task);
+
+    TaskNode *acquire(size_t index);
+
+    TaskNode *stealFromOthers(size_t index);
+
+    void workerLoop(size_t index);
+
     // 线程工作组
     std::vector<std::thread> workers;
-    // 任务队列
-    std::queue<std::function<void()> > tasks;
+    // 每个工作线程的本地任务队列，由工作线程自己创建
+    std::vector<std::unique_ptr<WorkStealingDeque<TaskNode *>>> localQueues;
+    // 所有工作线程都创建好本地队列之后才开始取任务（取任务时会访问其他线程的队列）
+    std::latch queuesReady;
+    // 全局注入队列：来自非工作线程的任务，通过 TaskNode::next 串成侵入式链表，入队出队都不分配内存
+    TaskNode *tasksHead = nullptr;
+    TaskNode *tasksTail = nullptr;
+    std::atomic<size_t> globalCount{0};
 
     // 同步
     std::mutex queue_mutex;
     std::condition_variable condition;
-    bool stop;
+    std::atomic<bool> stop;
+    // 已提交但尚未被取走的任务数，以及正在睡眠的工作线程数
+    std::atomic<size_t> pending{0};
+    std::atomic<size_t> idleWorkers{0};
+
+    // 指标
+    MetricCounter &tasksRun;
+    LatencyHistogram &queueWait;
+    MetricCounter idleNanos;
+    // 声明在最后，最先注销，采集回调不会访问已经析构的成员
+    std::vector<MetricsRegistration> metrics;
+
+    // 当前线程所属的线程池及其编号，用于判断是否可以本地提交
+    inline static thread_local ThreadPool *currentPool = nullptr;
+    inline static thread_local size_t currentIndex = 0;
 };
 
 // 构造函数
-ThreadPool::ThreadPool(size_t threads)
-        : stop(false) {
-    for (size_t i = 0; i < threads; ++i)
-        workers.emplace_back(
-                [this] {
-                    for (;;) {
-                        std::function<void()> task;
-
-                        {
-                            std::unique_lock<std::mutex> lock(this->queue_mutex);
-                            this->condition.wait(lock,
-                                                 [this] { return this->stop || !this->tasks.empty(); });
-                            if (this->stop && this->tasks.empty())
-                                return;
-                            task = std::move(this->tasks.front());
-                            this->tasks.pop();
-                        }
-
-                        task();
-                    }
-                }
-        );
+inline ThreadPool::ThreadPool(size_t threads, const ThreadPlacement &placement)
+        : localQueues(threads), queuesReady(static_cast<std::ptrdiff_t>(threads) + 1), stop(false),
+          tasksRun(MetricsRegistry::instance().counter(
+                  "eventloop_threadpool_tasks_total", poolLabel(placement), "Tasks executed by the thread pool")),
+          queueWait(MetricsRegistry::instance().histogram(
+                  "eventloop_threadpool_queue_wait_seconds", poolLabel(placement),
+                  "Sampled time from submission to the start of execution")) {
+    registerMetrics(poolLabel(placement), threads);
+    std::vector<int> cpus = placement.plan(threads);
+    for (size_t i = 0; i < threads; ++i) {
+        workers.emplace_back([this, i, cpu = cpus[i], name = placement.threadName(i)] {
+            ThreadPlacement::applyToCurrentThread(cpu, name);
+            localQueues[i] = std::make_unique<WorkStealingDeque<TaskNode *>>();
+            queuesReady.arrive_and_wait();
+            workerLoop(i);
+        });
+    }
+    queuesReady.arrive_and_wait();
 }
 
 // 析构函数
-ThreadPool::~ThreadPool() {
+inline ThreadPool::~ThreadPool() {
     {
         std::unique_lock<std::mutex> lock(queue_mutex);
         stop = true;
@@ -74,30 +138,154 @@ ThreadPool::~ThreadPool() {
         worker.join();
 }
 
+inline std::string ThreadPool::poolLabel(const ThreadPlacement &placement) {
+    return MetricsRegistry::label("pool", placement.namePrefix.empty() ? "default" : placement.namePrefix);
+}
+
+inline void ThreadPool::registerMetrics(const std::string &labels, size_t threads) {
+    MetricsRegistry &registry = MetricsRegistry::instance();
+    metrics.push_back(registry.observe("eventloop_threadpool_pending_tasks", labels, MetricType::Gauge, [this] {
+        return static_cast<double>(pending.load(std::memory_order_relaxed));
+    }, "Tasks submitted but not yet started"));
+    metrics.push_back(registry.observe("eventloop_threadpool_threads", labels, MetricType::Gauge, [threads] {
+        return static_cast<double>(threads);
+    }, "Worker threads"));
+    metrics.push_back(registry.observe("eventloop_threadpool_idle_seconds_total", labels, MetricType::Counter, [this] {
+        return static_cast<double>(idleNanos.value()) / 1e9;
+    }, "Time worker threads spent sleeping for lack of tasks"));
+}
+
+inline void ThreadPool::submit(TaskNode *task) {
+    if (currentPool == this) {
+        localQueues[currentIndex]->push(task);
+    } else {
+        std::unique_lock<std::mutex> lock(queue_mutex);
+        if (stop) {
+            TaskNodePool::release(task);
+            throw std::runtime_error("enqueue on stopped ThreadPool");
+        }
+        task->next = nullptr;
+        if (tasksTail) {
+            tasksTail->next = task;
+        } else {
+            tasksHead = task;
+        }
+        tasksTail = task;
+        globalCount.fetch_add(1, std::memory_order_relaxed);
+    }
+    // 先让任务可见再计数，与 workerLoop 中的睡眠检查配对，保证不会丢失唤醒
+    pending.fetch_add(1, std::memory_order_seq_cst);
+    if (idleWorkers.load(std::memory_order_seq_cst) > 0) {
+        { std::lock_guard<std::mutex> lock(queue_mutex); }
+        condition.notify_one();
+    }
+}
+
+inline TaskNode *ThreadPool::acquire(size_t index) {
+    TaskNode *task = localQueues[index]->pop();
+    if (!task && globalCount.load(std::memory_order_relaxed) > 0) {
+        std::unique_lock<std::mutex> lock(queue_mutex);
+        if (tasksHead) {
+            task = tasksHead;
+            tasksHead = task->next;
+            if (!tasksHead) {
+                tasksTail = nullptr;
+            }
+            globalCount.fetch_sub(1, std::memory_order_relaxed);
+        }
+    }
+    if (!task) {
+        task = stealFromOthers(index);
+    }
+    if (task) {
+        pending.fetch_sub(1, std::memory_order_seq_cst);
+    }
+    return task;
+}
+
+// 从随机选择的线程开始依次尝试窃取
+inline TaskNode *ThreadPool::stealFromOthers(size_t index) {
+    static thread_local uint64_t seed = std::hash<std::thread::id>{}(std::this_thread::get_id()) | 1;
+    seed ^= seed << 13;
+    seed ^= seed >> 7;
+    seed ^= seed << 17;
+
+    size_t n = localQueues.size();
+    size_t start = seed % n;
+    for (size_t i = 0; i < n; ++i) {
+        size_t victim = (start + i) % n;
+        if (victim == index || localQueues[victim]->empty()) {
+            continue;
+        }
+        if (TaskNode *task = localQueues[victim]->steal()) {
+            return task;
+        }
+    }
+    return nullptr;
+}
+
+inline void ThreadPool::workerLoop(size_t index) {
+    currentPool = this;
+    currentIndex = index;
+    for (;;) {
+        if (TaskNode *task = acquire(index)) {
+            if (task->enqueuedNanos != 0) {
+                queueWait.record(static_cast<uint64_t>(metricsNow() - task->enqueuedNanos));
+            }
+            try {
+                task->task();
+            } catch (const std::exception &e) {
+                LOG_ERROR("ThreadPool task threw: ", e.what());
+            } catch (...) {
+                LOG_ERROR("ThreadPool task threw an unknown exception");
+            }
+            TaskNodePool::release(task);
+            tasksRun.add();
+            continue;
+        }
+
+        std::unique_lock<std::mutex> lock(this->queue_mutex);
+        idleWorkers.fetch_add(1, std::memory_order_seq_cst);
+        int64_t idleSince = metricsNow();
+        this->condition.wait(lock,
+                             [this] { return this->stop || pending.load(std::memory_order_seq_cst) > 0; });
+        idleNanos.add(static_cast<uint64_t>(metricsNow() - idleSince));
+        idleWorkers.fetch_sub(1, std::memory_order_seq_cst);
+        if (this->stop && pending.load(std::memory_order_seq_cst) == 0)
+            return;
+    }
+}
+
 // 任务提交
 template<class F, class... Args>
 auto ThreadPool::enqueue(F&& f, Args&&... args)
 -> std::future<typename std::invoke_result<F, Args...>::type> {
     using return_type = typename std::invoke_result<F, Args...>::type;
 
-    auto task = std::make_shared<std::packaged_task<return_type()>>(
-            [f = std::forward<F>(f), args...]() -> return_type {
-                return f(std::forward<Args>(args)...);
+    // packaged_task 只能移动，直接放进 Task 里，不再需要 shared_ptr 包装
+    std::packaged_task<return_type()> task(
+            [f = std::forward<F>(f), ...args = std::forward<Args>(args)]() mutable -> return_type {
+                return std::invoke(std::move(f), std::forward<Args>(args)...);
             }
     );
 
-    std::future<return_type> res = task->get_future();
-    {
-        std::unique_lock<std::mutex> lock(queue_mutex);
-        if (stop) {
-            throw std::runtime_error("enqueue on stopped ThreadPool");
-        }
-        tasks.emplace([task]() { (*task)(); });
-    }
-    condition.notify_one();
+    std::future<return_type> res = task.get_future();
+    post(std::move(task));
     return res;
 }
 
+template<class F>
+void ThreadPool::post(F&& f) {
+    if (stop) {
+        throw std::runtime_error("enqueue on stopped ThreadPool");
+    }
+    TaskNode *node = TaskNodePool::allocate();
+    node->task.emplace(std::forward<F>(f));
+    thread_local uint32_t submitted = 0;
+    node->enqueuedNanos = ++submitted % QUEUE_WAIT_SAMPLE == 0 ? metricsNow() : 0;
+    submit(node);
+}
+
 
 
 #endif //EVENTLOOPMANAGER_THREADPOOL_H
@@ -10,6 +10,8 @@
 #include <mutex>
 #include <condition_variable>
 #include <exception>
+#include <algorithm>
+#include <stdexcept>
 #include "ThreadSafeQueueInterface.h"
 
 template<typename T>
@@ -18,24 +20,56 @@ private:
     std::queue<T> que;
     mutable std::mutex mtx;
     mutable std::condition_variable cv;
-    size_t capacity = 0;
+    std::condition_variable notFull;
+    size_t capacity = 0; // 0 表示不限容量
+
+    bool full() const {
+        return capacity != 0 && que.size() >= capacity;
+    }
+
+    // 调用方需持有 mtx；取走元素后唤醒等待空位的生产者
+    T popLocked() {
+        auto value = std::move(que.front());
+        que.pop();
+        if (capacity != 0) {
+            notFull.notify_one();
+        }
+        return value;
+    }
 
 public:
     ThreadSafeBlockingQueue() = default;
+
+    // 有界队列：队列满时 push 阻塞，tryPush 返回 false
+    explicit ThreadSafeBlockingQueue(size_t capacity) : capacity(capacity) {}
+
     ~ThreadSafeBlockingQueue() = default;
 
     void push(const T &value) {
+        push(this->copyOf(value));
+    }
+
+    void push(T &&value) {
+        std::unique_lock<std::mutex> lock(mtx);
+        notFull.wait(lock, [this] { return !full(); });
+        que.emplace(std::move(value));
+        cv.notify_one();
+    }
+
+    bool tryPush(T &&value) {
         std::lock_guard<std::mutex> lock(mtx);
-        que.emplace(value);
+        if (full()) {
+            return false;
+        }
+        que.emplace(std::move(value));
         cv.notify_one();
+        return true;
     }
 
     T waitAndPop() {
         std::unique_lock<std::mutex> lock(mtx);
         cv.wait(lock, [this] { return !que.empty(); });
-        auto value = std::move(que.front());
-        que.pop();
-        return value;
+        return popLocked();
     }
 
     T pop() {
@@ -43,9 +77,15 @@ public:
         if (que.empty()) {
             throw std::runtime_error("Queue is empty");
         }
-        auto value = std::move(que.front());
-        que.pop();
-        return value;
+        return popLocked();
+    }
+
+    std::optional<T> tryPop() {
+        std::lock_guard<std::mutex> lock(mtx);
+        if (que.empty()) {
+            return std::nullopt;
+        }
+        return popLocked();
     }
 
     T front() const {
@@ -53,13 +93,13 @@ public:
         if (que.empty()) {
             throw std::runtime_error("Queue is empty");
         }
-        return que.front();
+        return this->copyOf(que.front());
     }
 
     T waitAndFront() const {
         std::unique_lock<std::mutex> lock(mtx);
         cv.wait(lock, [this] { return !que.empty(); });
-        return que.front();
+        return this->copyOf(que.front());
     }
 
     T back() const {
@@ -67,13 +107,13 @@ public:
         if (que.empty()) {
             throw std::runtime_error("Queue is empty");
         }
-        return que.back();
+        return this->copyOf(que.back());
     }
 
     T waitAndBack() const {
         std::unique_lock<std::mutex> lock(mtx);
         cv.wait(lock, [this] { return !que.empty(); });
-        return que.back();
+        return this->copyOf(que.back());
     }
 
     bool empty() const {
@@ -90,6 +130,68 @@ public:
         std::lock_guard<std::mutex> lock(mtx);
         std::queue<T> empty;
         std::swap(que, empty);
+        notFull.notify_all();
+    }
+
+    void pushBulk(std::span<const T> values) {
+        pushRange(values, [](const T &value) { return ThreadSafeQueueInterface<T>::copyOf(value); });
+    }
+
+    void pushBulk(std::vector<T> &&values) {
+        pushRange(values, [](T &value) -> T && { return std::move(value); });
+        values.clear();
+    }
+
+    size_t tryPopBulk(std::vector<T> &out, size_t max) {
+        std::lock_guard<std::mutex> lock(mtx);
+        return popBulkLocked(out, max);
+    }
+
+    size_t waitAndPopBulk(std::vector<T> &out, size_t max, std::chrono::nanoseconds timeout) {
+        std::unique_lock<std::mutex> lock(mtx);
+        if (!cv.wait_for(lock, timeout, [this] { return !que.empty(); })) {
+            return 0;
+        }
+        return popBulkLocked(out, max);
+    }
+
+private:
+    // 在一次加锁内放入整批数据，convert 决定复制还是移动
+    template<typename Range, typename Convert>
+    void pushRange(Range &values, Convert convert) {
+        if (values.empty()) {
+            return;
+        }
+        {
+            std::unique_lock<std::mutex> lock(mtx);
+            for (auto &value: values) {
+                if (full()) {
+                    // 有界队列放不下整批数据时，先唤醒消费者再等待空位
+                    cv.notify_all();
+                    notFull.wait(lock, [this] { return !full(); });
+                }
+                que.emplace(convert(value));
+            }
+        }
+        if (values.size() == 1) {
+            cv.notify_one();
+        } else {
+            cv.notify_all();
+        }
+    }
+
+    // 调用方需持有 mtx
+    size_t popBulkLocked(std::vector<T> &out, size_t max) {
+        size_t count = std::min(max, que.size());
+        out.reserve(out.size() + count);
+        for (size_t i = 0; i < count; ++i) {
+            out.push_back(std::move(que.front()));
+            que.pop();
+        }
+        if (capacity != 0 && count > 0) {
+            notFull.notify_all();
+        }
+        return count;
     }
 
 };
@@ -9,6 +9,8 @@
 #include <condition_variable>
 #include <queue>
 #include <iostream>
+#include <algorithm>
+#include <stdexcept>
 #include "ThreadSafeQueueInterface.h"
 
 #ifndef EVENTLOOPMANAGER_THREADSAFECONCURRENTREADQUEUE_H
@@ -33,12 +35,22 @@ public:
     ThreadSafeConcurrentReadQueue() = default;
     ~ThreadSafeConcurrentReadQueue() = default;
 
-    void push(T value) {
+    void push(const T &value) {
+        push(this->copyOf(value));
+    }
+
+    void push(T &&value) {
         std::lock_guard<std::shared_mutex> lock(mtx);
-        que.emplace(value);
+        que.emplace(std::move(value));
         cv.notify_one();
     }
 
+    // 无界队列，总是成功
+    bool tryPush(T &&value) {
+        push(std::move(value));
+        return true;
+    }
+
     T pop() {
         std::lock_guard<std::shared_mutex> lock(mtx);
         if (que.empty()) {
@@ -57,18 +69,28 @@ public:
         return value;
     }
 
+    std::optional<T> tryPop() {
+        std::lock_guard<std::shared_mutex> lock(mtx);
+        if (que.empty()) {
+            return std::nullopt;
+        }
+        auto value = std::move(que.front());
+        que.pop();
+        return value;
+    }
+
     T front() const {
         std::shared_lock<std::shared_mutex> lock(mtx);
         if (que.empty()) {
             throw std::runtime_error("Queue is empty");
         }
-        return que.front();
+        return this->copyOf(que.front());
     }
 
     T waitAndFront() const {
         std::unique_lock<std::shared_mutex> lock(mtx);
         cv.wait(lock, [this] { return !que.empty(); });
-        return que.front();
+        return this->copyOf(que.front());
     }
 
     T back() const {
@@ -76,13 +98,13 @@ public:
         if (que.empty()) {
             throw std::runtime_error("Queue is empty");
         }
-        return que.back();
+        return this->copyOf(que.back());
     }
 
     T waitAndBack() const {
         std::unique_lock<std::shared_mutex> lock(mtx);
         cv.wait(lock, [this] { return !que.empty(); });
-        return que.back();
+        return this->copyOf(que.back());
     }
 
     bool empty() const {
@@ -100,6 +122,55 @@ public:
         std::queue<T> empty;
         std::swap(que, empty);
     }
+
+    void pushBulk(std::span<const T> values) {
+        pushRange(values, [](const T &value) { return ThreadSafeQueueInterface<T>::copyOf(value); });
+    }
+
+    void pushBulk(std::vector<T> &&values) {
+        pushRange(values, [](T &value) -> T && { return std::move(value); });
+        values.clear();
+    }
+
+    size_t tryPopBulk(std::vector<T> &out, size_t max) {
+        std::lock_guard<std::shared_mutex> lock(mtx);
+        return popBulkLocked(out, max);
+    }
+
+    size_t waitAndPopBulk(std::vector<T> &out, size_t max, std::chrono::nanoseconds timeout) {
+        std::unique_lock<std::shared_mutex> lock(mtx);
+        if (!cv.wait_for(lock, timeout, [this] { return !que.empty(); })) {
+            return 0;
+        }
+        return popBulkLocked(out, max);
+    }
+
+private:
+    // 在一次加锁内放入整批数据，convert 决定复制还是移动
+    template<typename Range, typename Convert>
+    void pushRange(Range &values, Convert convert) {
+        if (values.empty()) {
+            return;
+        }
+        {
+            std::lock_guard<std::shared_mutex> lock(mtx);
+            for (auto &value: values) {
+                que.emplace(convert(value));
+            }
+        }
+        cv.notify_all();
+    }
+
+    // 调用方需持有写锁
+    size_t popBulkLocked(std::vector<T> &out, size_t max) {
+        size_t count = std::min(max, que.size());
+        out.reserve(out.size() + count);
+        for (size_t i = 0; i < count; ++i) {
+            out.push_back(std::move(que.front()));
+            que.pop();
+        }
+        return count;
+    }
 };
 
 #endif //EVENTLOOPMANAGER_THREADSAFECONCURRENTREADQUEUE_H
\ No newline at end of file
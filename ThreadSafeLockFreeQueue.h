@@ -0,0 +1,310 @@
+#ifndef EVENTLOOPMANAGER_THREADSAFELOCKFREEQUEUE_H
+#define EVENTLOOPMANAGER_THREADSAFELOCKFREEQUEUE_H
+
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <memory>
+#include <new>
+#include <optional>
+#include <stdexcept>
+#include <utility>
+#include "CacheLine.h"
+#include "EventCount.h"
+#include "ThreadSafeQueueInterface.h"
+
+/*
+ * 有界无锁 MPMC 环形队列（Dmitry Vyukov 的 bounded MPMC queue）。
+ * 每个槽位带一个序号 sequence，生产者和消费者各自通过 CAS 抢占 enqueuePos / dequeuePos，
+ * 抢到位置之后只访问自己的槽位，因此 push / pop 都不需要加锁。
+ * enqueuePos 与 dequeuePos 分别独占一个缓存行，避免生产者和消费者之间的伪共享。
+ *
+ * 容量固定（向上取整为 2 的幂）。队列满时 push 阻塞，tryPush 返回 false；
+ * 队列空时 waitAndPop 阻塞，pop 抛出异常。阻塞只发生在满/空的时候，通过 EventCount 实现。
+ *
+ * 由于元素随时可能被其他线程取走，front/back 这类“只看不取”的操作无法安全实现，会抛出 std::logic_error。
+ */
+template<typename T>
+class ThreadSafeLockFreeQueue : public ThreadSafeQueueInterface<T> {
+private:
+    struct Cell {
+        std::atomic<size_t> sequence;
+        alignas(T) unsigned char storage[sizeof(T)];
+
+        T *value() noexcept {
+            return std::launder(reinterpret_cast<T *>(storage));
+        }
+    };
+
+    const size_t mask;
+    std::unique_ptr<Cell[]> cells;
+
+    alignas(CACHE_LINE_SIZE) std::atomic<size_t> enqueuePos{0};
+    alignas(CACHE_LINE_SIZE) std::atomic<size_t> dequeuePos{0};
+
+    alignas(CACHE_LINE_SIZE) EventCount notEmpty;
+    EventCount notFull;
+
+    static size_t roundUpToPowerOfTwo(size_t n) {
+        size_t result = 2;
+        while (result < n) {
+            result <<= 1;
+        }
+        return result;
+    }
+
+    // 取出队头元素并交给 consumer 处理，避免要求 T 可默认构造
+    template<typename Consumer>
+    bool tryConsume(Consumer &&consumer) {
+        if (!tryConsumeQuietly(std::forward<Consumer>(consumer))) {
+            return false;
+        }
+        notFull.notifyOne();
+        return true;
+    }
+
+    // 同 tryConsume，但不唤醒等待空位的生产者，由批量操作在整批完成后统一唤醒
+    template<typename Consumer>
+    bool tryConsumeQuietly(Consumer &&consumer) {
+        size_t pos = dequeuePos.load(std::memory_order_relaxed);
+        Cell *cell;
+        for (;;) {
+            cell = &cells[pos & mask];
+            size_t seq = cell->sequence.load(std::memory_order_acquire);
+            auto diff = static_cast<std::ptrdiff_t>(seq) - static_cast<std::ptrdiff_t>(pos + 1);
+            if (diff == 0) {
+                if (dequeuePos.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) {
+                    break;
+                }
+            } else if (diff < 0) {
+                return false; // 队列为空
+            } else {
+                pos = dequeuePos.load(std::memory_order_relaxed);
+            }
+        }
+        T *slot = cell->value();
+        consumer(std::move(*slot));
+        slot->~T();
+        cell->sequence.store(pos + mask + 1, std::memory_order_release);
+        return true;
+    }
+
+    // 同 tryEmplace，但不唤醒等待数据的消费者
+    template<typename... Args>
+    bool tryEmplaceQuietly(Args &&... args) {
+        size_t pos = enqueuePos.load(std::memory_order_relaxed);
+        Cell *cell;
+        for (;;) {
+            cell = &cells[pos & mask];
+            size_t seq = cell->sequence.load(std::memory_order_acquire);
+            auto diff = static_cast<std::ptrdiff_t>(seq) - static_cast<std::ptrdiff_t>(pos);
+            if (diff == 0) {
+                if (enqueuePos.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) {
+                    break;
+                }
+            } else if (diff < 0) {
+                return false; // 队列已满
+            } else {
+                pos = enqueuePos.load(std::memory_order_relaxed);
+            }
+        }
+        new(cell->storage) T(std::forward<Args>(args)...);
+        cell->sequence.store(pos + 1, std::memory_order_release);
+        return true;
+    }
+
+    // 批量入队：逐个抢占槽位但不逐个唤醒，整批（或队列满、需要等待消费者腾出空位之前）只唤醒一次
+    template<typename Value>
+    void pushBulkQuietly(Value &&value, size_t &unannounced) {
+        while (!tryEmplaceQuietly(std::forward<Value>(value))) {
+            if (unannounced != 0) {
+                notEmpty.notifyAll();
+                unannounced = 0;
+            }
+            auto key = notFull.prepareWait();
+            if (!full()) {
+                notFull.cancelWait();
+                continue;
+            }
+            notFull.wait(key);
+        }
+        ++unannounced;
+    }
+
+public:
+    explicit ThreadSafeLockFreeQueue(size_t capacity = 1024)
+            : mask(roundUpToPowerOfTwo(capacity) - 1), cells(new Cell[mask + 1]) {
+        for (size_t i = 0; i <= mask; ++i) {
+            cells[i].sequence.store(i, std::memory_order_relaxed);
+        }
+    }
+
+    ~ThreadSafeLockFreeQueue() {
+        clear();
+    }
+
+    ThreadSafeLockFreeQueue(const ThreadSafeLockFreeQueue &) = delete;
+    ThreadSafeLockFreeQueue &operator=(const ThreadSafeLockFreeQueue &) = delete;
+
+    size_t capacity() const {
+        return mask + 1;
+    }
+
+    // Inserts value if there is room. Returns false without blocking when the queue is full.
+    bool tryPush(const T &value) {
+        return tryEmplace(this->copyOf(value));
+    }
+
+    bool tryPush(T &&value) {
+        return tryEmplace(std::move(value));
+    }
+
+    // Constructs an element in place from args if there is room. Returns false when the queue is full.
+    template<typename... Args>
+    bool tryEmplace(Args &&... args) {
+        if (!tryEmplaceQuietly(std::forward<Args>(args)...)) {
+            return false;
+        }
+        notEmpty.notifyOne();
+        return true;
+    }
+
+    // Removes the head into value. Returns false without blocking when the queue is empty.
+    bool tryPop(T &value) {
+        return tryConsume([&value](T &&head) { value = std::move(head); });
+    }
+
+    void push(const T &value) {
+        push(this->copyOf(value));
+    }
+
+    void push(T &&value) {
+        while (!tryPush(std::move(value))) {
+            auto key = notFull.prepareWait();
+            if (!full()) {
+                notFull.cancelWait();
+                continue;
+            }
+            notFull.wait(key);
+        }
+    }
+
+    T waitAndPop() {
+        std::optional<T> value;
+        while (!tryConsume([&value](T &&head) { value.emplace(std::move(head)); })) {
+            auto key = notEmpty.prepareWait();
+            if (!empty()) {
+                notEmpty.cancelWait();
+                continue;
+            }
+            notEmpty.wait(key);
+        }
+        return std::move(*value);
+    }
+
+    T pop() {
+        std::optional<T> value;
+        if (!tryConsume([&value](T &&head) { value.emplace(std::move(head)); })) {
+            throw std::runtime_error("Queue is empty");
+        }
+        return std::move(*value);
+    }
+
+    std::optional<T> tryPop() {
+        std::optional<T> value;
+        tryConsume([&value](T &&head) { value.emplace(std::move(head)); });
+        return value;
+    }
+
+    T front() const {
+        throw std::logic_error("front() is not supported by ThreadSafeLockFreeQueue");
+    }
+
+    T waitAndFront() const {
+        throw std::logic_error("waitAndFront() is not supported by ThreadSafeLockFreeQueue");
+    }
+
+    T back() const {
+        throw std::logic_error("back() is not supported by ThreadSafeLockFreeQueue");
+    }
+
+    T waitAndBack() const {
+        throw std::logic_error("waitAndBack() is not supported by ThreadSafeLockFreeQueue");
+    }
+
+    // 以下三个方法在并发修改时只是一个快照
+    bool empty() const {
+        return size() == 0;
+    }
+
+    size_t size() const {
+        size_t head = dequeuePos.load(std::memory_order_seq_cst);
+        size_t tail = enqueuePos.load(std::memory_order_seq_cst);
+        return tail > head ? tail - head : 0;
+    }
+
+    bool full() const {
+        return size() >= capacity();
+    }
+
+    void clear() {
+        while (tryConsume([](T &&) {})) {}
+    }
+
+    // 每个元素仍然各自用 CAS 抢占槽位，但整批只唤醒一次消费者（队列满需要等待时先唤醒已经放入的部分）
+    void pushBulk(std::span<const T> values) {
+        size_t unannounced = 0;
+        for (const auto &value: values) {
+            pushBulkQuietly(this->copyOf(value), unannounced);
+        }
+        if (unannounced != 0) {
+            notEmpty.notifyAll();
+        }
+    }
+
+    void pushBulk(std::vector<T> &&values) {
+        size_t unannounced = 0;
+        for (auto &value: values) {
+            pushBulkQuietly(std::move(value), unannounced);
+        }
+        if (unannounced != 0) {
+            notEmpty.notifyAll();
+        }
+        values.clear();
+    }
+
+    // 整批取完后只唤醒一次等待空位的生产者
+    size_t tryPopBulk(std::vector<T> &out, size_t max) {
+        size_t count = 0;
+        while (count < max && tryConsumeQuietly([&out](T &&head) { out.push_back(std::move(head)); })) {
+            ++count;
+        }
+        if (count != 0) {
+            notFull.notifyAll();
+        }
+        return count;
+    }
+
+    size_t waitAndPopBulk(std::vector<T> &out, size_t max, std::chrono::nanoseconds timeout) {
+        if (max == 0) {
+            return 0;
+        }
+        auto deadline = std::chrono::steady_clock::now() + timeout;
+        for (;;) {
+            if (size_t count = tryPopBulk(out, max)) {
+                return count;
+            }
+            auto key = notEmpty.prepareWait();
+            if (!empty()) {
+                notEmpty.cancelWait();
+                continue;
+            }
+            if (!notEmpty.waitUntil(key, deadline)) {
+                return tryPopBulk(out, max);
+            }
+        }
+    }
+};
+
+
+#endif //EVENTLOOPMANAGER_THREADSAFELOCKFREEQUEUE_H
@@ -0,0 +1,275 @@
+#ifndef EVENTLOOPMANAGER_THREADSAFEPRIORITYLANEQUEUE_H
+#define EVENTLOOPMANAGER_THREADSAFEPRIORITYLANEQUEUE_H
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <stdexcept>
+#include <utility>
+#include "CacheLine.h"
+#include "EventCount.h"
+#include "Priority.h"
+#include "ThreadSafeBlockingQueue.h"
+#include "ThreadSafeLockFreeQueue.h"
+#include "ThreadSafeQueueInterface.h"
+
+/*
+ * 多优先级队列：每个优先级一条独立的子队列（lane），出队按加权轮询（WRR）选择子队列。
+ *  - 每一轮中 High 最多连续取 weights[0] 条、Normal 最多 weights[1] 条、Low 最多 weights[2] 条，
+ *    配额用完或全部子队列为空时开始新的一轮。高优先级的数据总是先被取到，
+ *    但只要低优先级有数据，每一轮也至少能取到一条，不会被饿死；
+ *  - 子队列有界时使用无锁环形队列，容量按子队列分别计算；capacity 为 0 时使用无界的阻塞队列；
+ *  - 不指定优先级的 push / tryPush 进入 Normal 子队列。
+ * 多个消费者并发出队时，先用 CAS 扣一份配额再出队（配额为 0 时扣不到，不会回绕），子队列为空时把配额还回去；
+ * 新一轮的补充在 roundMutex 下按轮次编号进行，同一轮只补充一次，并发的补充不会互相覆盖已经扣掉的配额。
+ */
+template<typename T>
+class ThreadSafePriorityLaneQueue : public ThreadSafeQueueInterface<T> {
+public:
+    explicit ThreadSafePriorityLaneQueue(size_t capacity = 0, const PriorityWeights &weights = DEFAULT_PRIORITY_WEIGHTS)
+            : weights(weights) {
+        for (size_t i = 0; i < PRIORITY_LEVELS; ++i) {
+            if (weights[i] == 0) {
+                throw std::invalid_argument("priority lane weight must be positive");
+            }
+            if (capacity == 0) {
+                lanes[i] = std::make_unique<ThreadSafeBlockingQueue<T>>();
+            } else {
+                lanes[i] = std::make_unique<ThreadSafeLockFreeQueue<T>>(capacity);
+            }
+            credits[i].store(weights[i], std::memory_order_relaxed);
+        }
+    }
+
+    ThreadSafePriorityLaneQueue(const ThreadSafePriorityLaneQueue &) = delete;
+    ThreadSafePriorityLaneQueue &operator=(const ThreadSafePriorityLaneQueue &) = delete;
+
+    void push(const T &value) {
+        push(this->copyOf(value), Priority::Normal);
+    }
+
+    void push(T &&value) {
+        push(std::move(value), Priority::Normal);
+    }
+
+    void push(const T &value, Priority priority) {
+        push(this->copyOf(value), priority);
+    }
+
+    // 子队列满时阻塞
+    void push(T &&value, Priority priority) {
+        lanes[priorityIndex(priority)]->push(std::move(value));
+        notEmpty.notifyOne();
+    }
+
+    bool tryPush(T &&value) {
+        return tryPush(std::move(value), Priority::Normal);
+    }
+
+    // 子队列满时返回 false，value 保持不变
+    bool tryPush(T &&value, Priority priority) {
+        if (!lanes[priorityIndex(priority)]->tryPush(std::move(value))) {
+            return false;
+        }
+        notEmpty.notifyOne();
+        return true;
+    }
+
+    T waitAndPop() {
+        for (;;) {
+            if (auto value = tryPop()) {
+                return std::move(*value);
+            }
+            auto key = notEmpty.prepareWait();
+            if (!empty()) {
+                notEmpty.cancelWait();
+                continue;
+            }
+            notEmpty.wait(key);
+        }
+    }
+
+    T pop() {
+        if (auto value = tryPop()) {
+            return std::move(*value);
+        }
+        throw std::runtime_error("Queue is empty");
+    }
+
+    std::optional<T> tryPop() {
+        for (;;) {
+            uint64_t observed = round.load(std::memory_order_acquire);
+            // 在还有配额的子队列中按优先级取
+            for (size_t i = 0; i < PRIORITY_LEVELS; ++i) {
+                if (!takeCredit(i)) {
+                    continue;
+                }
+                if (auto value = lanes[i]->tryPop()) {
+                    return value;
+                }
+                credits[i].fetch_add(1, std::memory_order_relaxed);
+            }
+            if (empty()) {
+                return std::nullopt;
+            }
+            // 有配额的子队列都空了而其他子队列还有数据：开始新的一轮
+            startRound(observed);
+        }
+    }
+
+    // 从优先级最低的非空子队列取出一条，用于 DropOldest 策略腾出空位
+    std::optional<T> tryPopLowest() {
+        for (size_t i = PRIORITY_LEVELS; i-- > 0;) {
+            if (auto value = lanes[i]->tryPop()) {
+                return value;
+            }
+        }
+        return std::nullopt;
+    }
+
+    // 优先级最高的非空子队列的队头；子队列不支持查看时抛出 std::logic_error
+    T front() const {
+        for (auto &lane: lanes) {
+            if (!lane->empty()) {
+                return lane->front();
+            }
+        }
+        throw std::runtime_error("Queue is empty");
+    }
+
+    T waitAndFront() const {
+        waitNotEmpty();
+        return front();
+    }
+
+    // 优先级最低的非空子队列的队尾
+    T back() const {
+        for (size_t i = PRIORITY_LEVELS; i-- > 0;) {
+            if (!lanes[i]->empty()) {
+                return lanes[i]->back();
+            }
+        }
+        throw std::runtime_error("Queue is empty");
+    }
+
+    T waitAndBack() const {
+        waitNotEmpty();
+        return back();
+    }
+
+    bool empty() const {
+        for (auto &lane: lanes) {
+            if (!lane->empty()) {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    size_t size() const {
+        size_t total = 0;
+        for (auto &lane: lanes) {
+            total += lane->size();
+        }
+        return total;
+    }
+
+    size_t size(Priority priority) const {
+        return lanes[priorityIndex(priority)]->size();
+    }
+
+    void clear() {
+        for (auto &lane: lanes) {
+            lane->clear();
+        }
+    }
+
+    void pushBulk(std::span<const T> values) {
+        lanes[priorityIndex(Priority::Normal)]->pushBulk(values);
+        notEmpty.notifyAll();
+    }
+
+    void pushBulk(std::vector<T> &&values) {
+        lanes[priorityIndex(Priority::Normal)]->pushBulk(std::move(values));
+        notEmpty.notifyAll();
+    }
+
+    size_t tryPopBulk(std::vector<T> &out, size_t max) {
+        size_t count = 0;
+        while (count < max) {
+            auto value = tryPop();
+            if (!value) {
+                break;
+            }
+            out.push_back(std::move(*value));
+            ++count;
+        }
+        return count;
+    }
+
+    size_t waitAndPopBulk(std::vector<T> &out, size_t max, std::chrono::nanoseconds timeout) {
+        auto deadline = std::chrono::steady_clock::now() + timeout;
+        for (;;) {
+            if (size_t count = tryPopBulk(out, max)) {
+                return count;
+            }
+            auto key = notEmpty.prepareWait();
+            if (!empty()) {
+                notEmpty.cancelWait();
+                continue;
+            }
+            if (!notEmpty.waitUntil(key, deadline)) {
+                return tryPopBulk(out, max);
+            }
+        }
+    }
+
+private:
+    // 配额大于 0 时扣掉一份
+    bool takeCredit(size_t lane) {
+        uint32_t current = credits[lane].load(std::memory_order_relaxed);
+        while (current > 0) {
+            if (credits[lane].compare_exchange_weak(current, current - 1, std::memory_order_relaxed)) {
+                return true;
+            }
+        }
+        return false;
+    }
+
+    // 只有仍处在 observed 这一轮时才补充配额；其他消费者已经开始新一轮时直接返回，用它补充的配额重试
+    void startRound(uint64_t observed) {
+        std::lock_guard<std::mutex> lock(roundMutex);
+        if (round.load(std::memory_order_relaxed) != observed) {
+            return;
+        }
+        for (size_t i = 0; i < PRIORITY_LEVELS; ++i) {
+            credits[i].store(weights[i], std::memory_order_relaxed);
+        }
+        round.store(observed + 1, std::memory_order_release);
+    }
+
+    void waitNotEmpty() const {
+        while (empty()) {
+            auto key = notEmpty.prepareWait();
+            if (!empty()) {
+                notEmpty.cancelWait();
+                return;
+            }
+            notEmpty.wait(key);
+        }
+    }
+
+    const PriorityWeights weights;
+    std::array<std::unique_ptr<ThreadSafeQueueInterface<T>>, PRIORITY_LEVELS> lanes;
+    // 本轮剩余的配额
+    alignas(CACHE_LINE_SIZE) std::array<std::atomic<uint32_t>, PRIORITY_LEVELS> credits;
+    // 已经开始的轮数，由 roundMutex 保护写入
+    std::atomic<uint64_t> round{0};
+    std::mutex roundMutex;
+    alignas(CACHE_LINE_SIZE) mutable EventCount notEmpty;
+};
+
+#endif //EVENTLOOPMANAGER_THREADSAFEPRIORITYLANEQUEUE_H
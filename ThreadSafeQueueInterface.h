@@ -7,6 +7,14 @@
 #include <mutex>
 #include <condition_variable>
 #include <queue>
+#include <chrono>
+#include <iterator>
+#include <optional>
+#include <span>
+#include <stdexcept>
+#include <type_traits>
+#include <utility>
+#include <vector>
 
 template<typename T>
 class ThreadSafeQueueInterface {
@@ -17,13 +25,30 @@ public:
     // Inserts the specified element into this queue.
     virtual void push(const T& value) = 0;
 
+    // Inserts the specified element into this queue, moving from it.
+    virtual void push(T&& value) = 0;
+
+    // Inserts the specified element only if this can be done without waiting for room in a bounded queue.
+    // Returns false and leaves value untouched when the queue is full. Unbounded queues always succeed.
+    virtual bool tryPush(T&& value) = 0;
+
+    // Constructs an element from args and inserts it into this queue.
+    template<typename... Args>
+    void emplace(Args&&... args) {
+        push(T(std::forward<Args>(args)...));
+    }
+
     // Retrieves and removes the head of this queue, waiting if necessary until an element becomes available.
     virtual T waitAndPop() = 0;
 
     // Retrieves and removes the head of this queue. Throws an exception if the queue is empty.
     virtual T pop() = 0;
 
+    // Retrieves and removes the head of this queue, or returns an empty optional if the queue is empty.
+    virtual std::optional<T> tryPop() = 0;
+
     // Retrieves, but does not remove, the head of this queue. Throws an exception if the queue is empty.
+    // The peek operations copy the element, so they throw std::logic_error for move-only T.
     virtual T front() const = 0;
 
     // Retrieves the head of this queue, waiting if necessary until an element becomes available.
@@ -43,6 +68,44 @@ public:
 
     // Removes all of the elements from this queue.
     virtual void clear() = 0;
+
+    // Inserts all of the specified elements, in order, with a single synchronization where the backend allows it.
+    virtual void pushBulk(std::span<const T> values) = 0;
+
+    // Same as above, but moves the elements out of values and leaves it empty.
+    virtual void pushBulk(std::vector<T>&& values) = 0;
+
+    // Removes up to max elements from the head of this queue and appends them to out. Never blocks.
+    // Returns the number of elements removed.
+    virtual size_t tryPopBulk(std::vector<T>& out, size_t max) = 0;
+
+    // Like tryPopBulk, but waits up to timeout for at least one element to become available.
+    // Returns the number of elements removed, 0 on timeout.
+    virtual size_t waitAndPopBulk(std::vector<T>& out, size_t max, std::chrono::nanoseconds timeout) = 0;
+
+    // Removes all of the elements currently in this queue and appends them to out.
+    // Returns the number of elements removed.
+    template<typename Container>
+    size_t drainTo(Container& out) {
+        if constexpr (std::is_same_v<Container, std::vector<T>>) {
+            return tryPopBulk(out, SIZE_MAX);
+        } else {
+            std::vector<T> drained;
+            size_t count = tryPopBulk(drained, SIZE_MAX);
+            std::move(drained.begin(), drained.end(), std::inserter(out, out.end()));
+            return count;
+        }
+    }
+
+protected:
+    // 复制一个元素；元素类型只能移动时抛出 std::logic_error，让只能移动的 T 也可以实例化整个接口
+    static T copyOf(const T& value) {
+        if constexpr (std::is_copy_constructible_v<T>) {
+            return value;
+        } else {
+            throw std::logic_error("cannot copy a move-only element out of the queue");
+        }
+    }
 };
 
 
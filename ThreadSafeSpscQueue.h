@@ -0,0 +1,296 @@
+#ifndef EVENTLOOPMANAGER_THREADSAFESPSCQUEUE_H
+#define EVENTLOOPMANAGER_THREADSAFESPSCQUEUE_H
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <memory>
+#include <new>
+#include <optional>
+#include <stdexcept>
+#include <thread>
+#include <utility>
+#include "CacheLine.h"
+#include "EventCount.h"
+#include "ThreadSafeQueueInterface.h"
+
+/*
+ * 单生产者/单消费者（SPSC）有界环形队列。
+ * 只有生产者线程写 tail，只有消费者线程写 head，所以 tryPush / tryPop 都是 wait-free 的：
+ * 没有 CAS、没有锁，只有一次 acquire 读和一次 release 写。
+ * 双方各自缓存对方的位置（cachedHead / cachedTail），只有在看起来满/空时才去读对方的缓存行。
+ *
+ * 只有在环为空（waitAndPop）或为满（push）时才会通过 EventCount 睡眠，否则不会进入内核。
+ *
+ * 使用约束：push / tryPush 只能由同一个生产者线程调用，
+ * pop / tryPop / waitAndPop / front / waitAndFront 只能由同一个消费者线程调用。
+ */
+template<typename T>
+class ThreadSafeSpscQueue : public ThreadSafeQueueInterface<T> {
+private:
+    const size_t mask;
+    std::unique_ptr<std::aligned_storage_t<sizeof(T), alignof(T)>[]> slots;
+
+    // 消费者独占的缓存行
+    alignas(CACHE_LINE_SIZE) std::atomic<size_t> head{0};
+    mutable size_t cachedTail = 0;
+
+    // 生产者独占的缓存行
+    alignas(CACHE_LINE_SIZE) std::atomic<size_t> tail{0};
+    size_t cachedHead = 0;
+
+    alignas(CACHE_LINE_SIZE) mutable EventCount notEmpty;
+    EventCount notFull;
+
+    static constexpr int SPIN_LIMIT = 64;
+
+    static size_t roundUpToPowerOfTwo(size_t n) {
+        size_t result = 2;
+        while (result < n) {
+            result <<= 1;
+        }
+        return result;
+    }
+
+    T *slot(size_t pos) const noexcept {
+        return std::launder(reinterpret_cast<T *>(&slots[pos & mask]));
+    }
+
+    // 消费者侧：确认队头是否有元素
+    bool hasHead(size_t h) const {
+        if (h == cachedTail) {
+            cachedTail = tail.load(std::memory_order_acquire);
+        }
+        return h != cachedTail;
+    }
+
+    template<typename Consumer>
+    bool tryConsume(Consumer &&consumer) {
+        size_t h = head.load(std::memory_order_relaxed);
+        if (!hasHead(h)) {
+            return false;
+        }
+        T *value = slot(h);
+        consumer(std::move(*value));
+        value->~T();
+        head.store(h + 1, std::memory_order_release);
+        notFull.notifyOne();
+        return true;
+    }
+
+    void waitForHead() const {
+        // 热链路上先短暂让出 CPU 等待生产者，尽量避免真正睡眠
+        for (int i = 0; i < SPIN_LIMIT; ++i) {
+            if (hasHead(head.load(std::memory_order_relaxed))) {
+                return;
+            }
+            std::this_thread::yield();
+        }
+        while (!hasHead(head.load(std::memory_order_relaxed))) {
+            auto key = notEmpty.prepareWait();
+            if (!empty()) {
+                notEmpty.cancelWait();
+                return;
+            }
+            notEmpty.wait(key);
+        }
+    }
+
+    // 按可用空间分段写入，每段只发布一次 tail、只通知一次消费者；convert 决定复制还是移动
+    template<typename Range, typename Convert>
+    void pushRange(Range &values, Convert convert) {
+        size_t written = 0;
+        while (written < values.size()) {
+            size_t t = tail.load(std::memory_order_relaxed);
+            size_t room = capacity() - (t - cachedHead);
+            if (room == 0) {
+                cachedHead = head.load(std::memory_order_acquire);
+                room = capacity() - (t - cachedHead);
+            }
+            if (room == 0) {
+                auto key = notFull.prepareWait();
+                if (size() < capacity()) {
+                    notFull.cancelWait();
+                } else {
+                    notFull.wait(key);
+                }
+                continue;
+            }
+            size_t count = std::min(room, values.size() - written);
+            for (size_t i = 0; i < count; ++i) {
+                new(slot(t + i)) T(convert(values[written + i]));
+            }
+            tail.store(t + count, std::memory_order_release);
+            notEmpty.notifyOne();
+            written += count;
+        }
+    }
+
+public:
+    explicit ThreadSafeSpscQueue(size_t capacity = 1024)
+            : mask(roundUpToPowerOfTwo(capacity) - 1),
+              slots(new std::aligned_storage_t<sizeof(T), alignof(T)>[mask + 1]) {}
+
+    ~ThreadSafeSpscQueue() {
+        clear();
+    }
+
+    ThreadSafeSpscQueue(const ThreadSafeSpscQueue &) = delete;
+    ThreadSafeSpscQueue &operator=(const ThreadSafeSpscQueue &) = delete;
+
+    size_t capacity() const {
+        return mask + 1;
+    }
+
+    // Producer only. Inserts value if there is room; never blocks.
+    bool tryPush(const T &value) {
+        return tryEmplace(this->copyOf(value));
+    }
+
+    bool tryPush(T &&value) {
+        return tryEmplace(std::move(value));
+    }
+
+    // Producer only. Constructs an element in place from args if there is room; never blocks.
+    template<typename... Args>
+    bool tryEmplace(Args &&... args) {
+        size_t t = tail.load(std::memory_order_relaxed);
+        if (t - cachedHead > mask) {
+            cachedHead = head.load(std::memory_order_acquire);
+            if (t - cachedHead > mask) {
+                return false; // 队列已满
+            }
+        }
+        new(slot(t)) T(std::forward<Args>(args)...);
+        tail.store(t + 1, std::memory_order_release);
+        notEmpty.notifyOne();
+        return true;
+    }
+
+    // Consumer only. Removes the head into value; never blocks.
+    bool tryPop(T &value) {
+        return tryConsume([&value](T &&head) { value = std::move(head); });
+    }
+
+    void push(const T &value) {
+        push(this->copyOf(value));
+    }
+
+    void push(T &&value) {
+        while (!tryPush(std::move(value))) {
+            auto key = notFull.prepareWait();
+            if (size() < capacity()) {
+                notFull.cancelWait();
+                continue;
+            }
+            notFull.wait(key);
+        }
+    }
+
+    T waitAndPop() {
+        waitForHead();
+        return pop();
+    }
+
+    T pop() {
+        std::optional<T> value;
+        if (!tryConsume([&value](T &&head) { value.emplace(std::move(head)); })) {
+            throw std::runtime_error("Queue is empty");
+        }
+        return std::move(*value);
+    }
+
+    std::optional<T> tryPop() {
+        std::optional<T> value;
+        tryConsume([&value](T &&head) { value.emplace(std::move(head)); });
+        return value;
+    }
+
+    // Consumer only: nobody else can remove the head while the consumer is looking at it.
+    T front() const {
+        size_t h = head.load(std::memory_order_relaxed);
+        if (!hasHead(h)) {
+            throw std::runtime_error("Queue is empty");
+        }
+        return this->copyOf(*slot(h));
+    }
+
+    T waitAndFront() const {
+        waitForHead();
+        return this->copyOf(*slot(head.load(std::memory_order_relaxed)));
+    }
+
+    // 队尾元素可能正被消费者取走，无法安全读取
+    T back() const {
+        throw std::logic_error("back() is not supported by ThreadSafeSpscQueue");
+    }
+
+    T waitAndBack() const {
+        throw std::logic_error("waitAndBack() is not supported by ThreadSafeSpscQueue");
+    }
+
+    bool empty() const {
+        return size() == 0;
+    }
+
+    size_t size() const {
+        size_t h = head.load(std::memory_order_seq_cst);
+        size_t t = tail.load(std::memory_order_seq_cst);
+        return t - h;
+    }
+
+    // Consumer only.
+    void clear() {
+        while (tryConsume([](T &&) {})) {}
+    }
+
+    // Producer only.
+    void pushBulk(std::span<const T> values) {
+        pushRange(values, [](const T &value) { return ThreadSafeQueueInterface<T>::copyOf(value); });
+    }
+
+    void pushBulk(std::vector<T> &&values) {
+        pushRange(values, [](T &value) -> T && { return std::move(value); });
+        values.clear();
+    }
+
+    // Consumer only. 一次性取走最多 max 个元素，只发布一次 head
+    size_t tryPopBulk(std::vector<T> &out, size_t max) {
+        size_t h = head.load(std::memory_order_relaxed);
+        if (max == 0 || !hasHead(h)) {
+            return 0;
+        }
+        size_t count = std::min(max, cachedTail - h);
+        out.reserve(out.size() + count);
+        for (size_t i = 0; i < count; ++i) {
+            T *value = slot(h + i);
+            out.push_back(std::move(*value));
+            value->~T();
+        }
+        head.store(h + count, std::memory_order_release);
+        notFull.notifyOne();
+        return count;
+    }
+
+    size_t waitAndPopBulk(std::vector<T> &out, size_t max, std::chrono::nanoseconds timeout) {
+        if (max == 0) {
+            return 0;
+        }
+        auto deadline = std::chrono::steady_clock::now() + timeout;
+        while (!hasHead(head.load(std::memory_order_relaxed))) {
+            auto key = notEmpty.prepareWait();
+            if (!empty()) {
+                notEmpty.cancelWait();
+                break;
+            }
+            if (!notEmpty.waitUntil(key, deadline)) {
+                break;
+            }
+        }
+        return tryPopBulk(out, max);
+    }
+};
+
+
+#endif //EVENTLOOPMANAGER_THREADSAFESPSCQUEUE_H
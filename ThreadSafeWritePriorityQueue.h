@@ -9,6 +9,8 @@
 #include <shared_mutex>
 #include <condition_variable>
 #include <queue>
+#include <algorithm>
+#include <stdexcept>
 #include "ThreadSafeQueueInterface.h"
 
 template<typename T>
@@ -23,16 +25,26 @@ public:
     ThreadSafeWritePriorityQueue() = default;   // 默认构造函数
     ~ThreadSafeWritePriorityQueue() = default;
 
-    void push(T value) {
+    void push(const T &value) {
+        push(this->copyOf(value));
+    }
+
+    void push(T &&value) {
         std::unique_lock<std::shared_mutex> lock(mtx);
         writeWaitingCount++;
-        que.emplace(value);  // 使用 emplace 和 std::forward实现完美转发
+        que.emplace(std::move(value));  // 使用 emplace 和 std::forward实现完美转发
         writeWaitingCount--;
         readCond.notify_one();
         writeCond.notify_all();
     }
 
-    void pop() {
+    // 无界队列，总是成功
+    bool tryPush(T &&value) {
+        push(std::move(value));
+        return true;
+    }
+
+    T pop() {
         std::unique_lock<std::shared_mutex> lock(mtx);
         writeCond.wait(lock, [this] { return que.empty() || writeWaitingCount == 0; }); // 如果队列为空或者等待写的线程数为 0
         if (que.empty()) {
@@ -45,6 +57,7 @@ public:
         } else {
             readCond.notify_one();
         }
+        return value;
     }
 
     T waitAndPop() {
@@ -56,6 +69,20 @@ public:
             // 优先唤醒正在等待写入的线程
             writeCond.notify_one();
         }
+
+        return value;
+    }
+
+    std::optional<T> tryPop() {
+        std::unique_lock<std::shared_mutex> lock(mtx);
+        if (que.empty()) {
+            return std::nullopt;
+        }
+        T value = std::move(que.front());
+        que.pop();
+        if (writeWaitingCount > 0) {
+            writeCond.notify_one();
+        }
         return value;
     }
 
@@ -65,13 +92,13 @@ public:
         if (que.empty()) {
             throw std::runtime_error("front from empty queue");
         }
-        return que.front();
+        return this->copyOf(que.front());
     }
 
     T waitAndFront() const {
         std::unique_lock<std::shared_mutex> lock(mtx);
         readCond.wait(lock, [this] { return !que.empty(); });
-        return que.front();
+        return this->copyOf(que.front());
     }
 
     T back() const {
@@ -79,13 +106,13 @@ public:
         if (que.empty()) {
             throw std::runtime_error("back from empty queue");
         }
-        return que.back();
+        return this->copyOf(que.back());
     }
 
     T waitAndBack() const {
         std::unique_lock<std::shared_mutex> lock(mtx);
         readCond.wait(lock, [this] { return !que.empty(); });
-        return que.back();
+        return this->copyOf(que.back());
     }
 
     bool empty() const {
@@ -103,6 +130,60 @@ public:
         std::queue<T> empty;
         std::swap(que, empty);
     }
+
+    void pushBulk(std::span<const T> values) {
+        pushRange(values, [](const T &value) { return ThreadSafeQueueInterface<T>::copyOf(value); });
+    }
+
+    void pushBulk(std::vector<T> &&values) {
+        pushRange(values, [](T &value) -> T && { return std::move(value); });
+        values.clear();
+    }
+
+    size_t tryPopBulk(std::vector<T> &out, size_t max) {
+        std::unique_lock<std::shared_mutex> lock(mtx);
+        return popBulkLocked(out, max);
+    }
+
+    size_t waitAndPopBulk(std::vector<T> &out, size_t max, std::chrono::nanoseconds timeout) {
+        std::unique_lock<std::shared_mutex> lock(mtx);
+        if (!readCond.wait_for(lock, timeout, [this] { return !que.empty(); })) {
+            return 0;
+        }
+        return popBulkLocked(out, max);
+    }
+
+private:
+    // 在一次加锁内放入整批数据，convert 决定复制还是移动
+    template<typename Range, typename Convert>
+    void pushRange(Range &values, Convert convert) {
+        if (values.empty()) {
+            return;
+        }
+        std::unique_lock<std::shared_mutex> lock(mtx);
+        writeWaitingCount++;
+        for (auto &value: values) {
+            que.emplace(convert(value));
+        }
+        writeWaitingCount--;
+        readCond.notify_all();
+        writeCond.notify_all();
+    }
+
+    // 调用方需持有写锁
+    size_t popBulkLocked(std::vector<T> &out, size_t max) {
+        size_t count = std::min(max, que.size());
+        out.reserve(out.size() + count);
+        for (size_t i = 0; i < count; ++i) {
+            out.push_back(std::move(que.front()));
+            que.pop();
+        }
+        if (writeWaitingCount > 0) {
+            // 优先唤醒正在等待写入的线程
+            writeCond.notify_one();
+        }
+        return count;
+    }
 };
 
 
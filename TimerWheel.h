@@ -0,0 +1,224 @@
+#ifndef EVENTLOOPMANAGER_TIMERWHEEL_H
+#define EVENTLOOPMANAGER_TIMERWHEEL_H
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <memory>
+#include <optional>
+#include <unordered_map>
+#include <vector>
+#include "Task.h"
+
+/*
+ * 分层时间轮（Varghese & Lauck），结构与 Linux 内核的经典实现相同：
+ * LEVELS 层，每层 SLOTS 个槽，第 0 层一个槽对应一个 tick，第 k 层一个槽对应 SLOTS^k 个 tick。
+ *  - 插入：按剩余 tick 数直接算出层和槽，挂到槽的双向链表上，O(1)；
+ *  - 取消：通过编号找到节点后从链表摘下，O(1)；
+ *  - 推进：每走一个 tick 只处理第 0 层的一个槽；每走满一圈才把上一层的一个槽整体下放（cascade），
+ *    摊还后每个定时器只会被移动常数次。
+ * 超出最高层范围的定时器先挂在最高层最远的槽里，下放时重新计算位置。
+ *
+ * 本类不是线程安全的，由调用方加锁（Manager 使用 eventMutex）。
+ * 到期的回调不在 advance() 内执行，而是交给调用方在锁外执行。
+ */
+class TimerWheel {
+public:
+    using Clock = std::chrono::steady_clock;
+    using TimerId = uint64_t;
+
+    static constexpr size_t SLOT_BITS = 6;
+    static constexpr size_t SLOTS = size_t(1) << SLOT_BITS;
+    static constexpr size_t LEVELS = 4;
+
+    // 回调及其取消标记；到期的定时器以 shared_ptr 交给调用方，执行前检查 cancelled
+    struct Timer {
+        Task callback;
+        std::atomic<bool> cancelled{false};
+    };
+
+    explicit TimerWheel(Clock::duration tick = std::chrono::milliseconds(1), Clock::time_point origin = Clock::now())
+            : tick(tick), origin(origin) {
+        for (auto &level: wheel) {
+            for (auto &slot: level) {
+                slot.prev = slot.next = &slot;
+            }
+        }
+    }
+
+    TimerWheel(const TimerWheel &) = delete;
+    TimerWheel &operator=(const TimerWheel &) = delete;
+
+    ~TimerWheel() {
+        for (auto &[id, node]: nodes) {
+            node->timer->cancelled.store(true, std::memory_order_relaxed);
+        }
+    }
+
+    // 在 when 到期；period 非零时之后每隔 period 再次到期
+    TimerId schedule(Clock::time_point when, Clock::duration period, Task callback) {
+        auto node = std::make_unique<Node>();
+        node->id = nextId++;
+        // 向上取整到 tick，定时器不会早于 when 到期
+        node->expiry = when > origin ? ceilTicks(when - origin) : 0;
+        node->period = period > Clock::duration::zero() ? std::max<uint64_t>(1, ceilTicks(period)) : 0;
+        node->timer = std::make_shared<Timer>();
+        node->timer->callback = std::move(callback);
+        TimerId id = node->id;
+        insert(node.get());
+        nodes.emplace(id, std::move(node));
+        return id;
+    }
+
+    // 返回 false 表示定时器不存在（已经到期的一次性定时器或已取消）
+    bool cancel(TimerId id) {
+        auto it = nodes.find(id);
+        if (it == nodes.end()) {
+            return false;
+        }
+        Node *node = it->second.get();
+        node->timer->cancelled.store(true, std::memory_order_relaxed);
+        unlink(node);
+        nodes.erase(it);
+        return true;
+    }
+
+    // 推进到 now，把到期的定时器追加到 expired；周期定时器自动重新插入
+    void advance(Clock::time_point now, std::vector<std::shared_ptr<Timer>> &expired) {
+        uint64_t target = toTick(now);
+        while (currentTick <= target && !nodes.empty()) {
+            if ((currentTick & (SLOTS - 1)) == 0) {
+                cascade(1);
+            }
+            Node &head = wheel[0][currentTick & (SLOTS - 1)];
+            while (head.next != &head) {
+                Node *node = head.next;
+                unlink(node);
+                if (node->expiry > currentTick) {
+                    insert(node);
+                    continue;
+                }
+                expired.push_back(node->timer);
+                if (node->period != 0) {
+                    node->expiry += node->period;
+                    insert(node);
+                } else {
+                    nodes.erase(node->id);
+                }
+            }
+            ++currentTick;
+        }
+        if (nodes.empty() && currentTick <= target) {
+            currentTick = target + 1;
+        }
+    }
+
+    // 下一次需要调用 advance() 的时间；没有定时器时返回 std::nullopt。
+    // 第 0 层内没有定时器时返回下一次下放的时间，可能早于实际到期时间
+    std::optional<Clock::time_point> nextExpiry() const {
+        if (nodes.empty()) {
+            return std::nullopt;
+        }
+        // 下一个 tick 正好需要下放时，第 0 层的内容还不完整
+        if ((currentTick & (SLOTS - 1)) == 0) {
+            return toTime(currentTick);
+        }
+        for (uint64_t t = currentTick; t < currentTick + SLOTS; ++t) {
+            const Node &head = wheel[0][t & (SLOTS - 1)];
+            if (head.next != &head) {
+                return toTime(t);
+            }
+            if (((t + 1) & (SLOTS - 1)) == 0) {
+                return toTime(t + 1);
+            }
+        }
+        return toTime(currentTick + SLOTS);
+    }
+
+    size_t size() const {
+        return nodes.size();
+    }
+
+private:
+    // 链表头和定时器节点共用一个结构，空链表的头指向自己
+    struct Node {
+        Node *prev = nullptr;
+        Node *next = nullptr;
+        TimerId id = 0;
+        uint64_t expiry = 0;
+        uint64_t period = 0;
+        std::shared_ptr<Timer> timer;
+    };
+
+    uint64_t toTick(Clock::time_point when) const {
+        if (when <= origin) {
+            return 0;
+        }
+        return static_cast<uint64_t>((when - origin) / tick);
+    }
+
+    Clock::time_point toTime(uint64_t t) const {
+        return origin + tick * static_cast<int64_t>(t);
+    }
+
+    uint64_t ceilTicks(Clock::duration d) const {
+        return static_cast<uint64_t>((d + tick - Clock::duration(1)) / tick);
+    }
+
+    void insert(Node *node) {
+        if (node->expiry < currentTick) {
+            node->expiry = currentTick;
+        }
+        uint64_t delta = node->expiry - currentTick;
+        size_t level = 0;
+        while (level + 1 < LEVELS && delta >= (uint64_t(1) << (SLOT_BITS * (level + 1)))) {
+            ++level;
+        }
+        uint64_t position = node->expiry;
+        if (delta >= (uint64_t(1) << (SLOT_BITS * LEVELS))) {
+            // 超出范围：挂在最高层最远的槽上，下放时再重新计算
+            position = currentTick + ((SLOTS - 1) << (SLOT_BITS * (LEVELS - 1)));
+        }
+        Node &head = wheel[level][(position >> (SLOT_BITS * level)) & (SLOTS - 1)];
+        node->prev = head.prev;
+        node->next = &head;
+        head.prev->next = node;
+        head.prev = node;
+    }
+
+    static void unlink(Node *node) {
+        node->prev->next = node->next;
+        node->next->prev = node->prev;
+        node->prev = node->next = nullptr;
+    }
+
+    // 把第 level 层当前的槽整体重新插入到更低的层；这一层也转满一圈时先处理更高一层
+    void cascade(size_t level) {
+        if (level >= LEVELS) {
+            return;
+        }
+        size_t index = (currentTick >> (SLOT_BITS * level)) & (SLOTS - 1);
+        if (index == 0) {
+            cascade(level + 1);
+        }
+        Node &head = wheel[level][index];
+        Node *node = head.next;
+        head.prev = head.next = &head;
+        while (node != &head) {
+            Node *next = node->next;
+            insert(node);
+            node = next;
+        }
+    }
+
+    const Clock::duration tick;
+    const Clock::time_point origin;
+    // 下一个要处理的 tick
+    uint64_t currentTick = 0;
+    TimerId nextId = 1;
+    std::array<std::array<Node, SLOTS>, LEVELS> wheel;
+    std::unordered_map<TimerId, std::unique_ptr<Node>> nodes;
+};
+
+#endif //EVENTLOOPMANAGER_TIMERWHEEL_H
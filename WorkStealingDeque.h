@@ -0,0 +1,128 @@
+#ifndef EVENTLOOPMANAGER_WORKSTEALINGDEQUE_H
+#define EVENTLOOPMANAGER_WORKSTEALINGDEQUE_H
+
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <type_traits>
+#include <vector>
+#include "CacheLine.h"
+
+/*
+ * Chase-Lev 工作窃取双端队列（按 Lê 等人 2013 年的 C11 内存模型版本实现）。
+ * 拥有者线程在 bottom 端 push / pop（LIFO，缓存友好），其他线程在 top 端 steal（FIFO）。
+ * 拥有者的 push / pop 在无竞争时不需要任何 CAS，只有在争抢最后一个元素时才和窃取者 CAS top。
+ *
+ * T 必须是可以放进 std::atomic 的小类型（通常是指针），T{} 表示“没有取到元素”。
+ * 数组满时由拥有者扩容为两倍，旧数组保留到析构时再释放，因为窃取者可能仍在读取它。
+ */
+template<typename T>
+class WorkStealingDeque {
+    static_assert(std::is_trivially_copyable_v<T>, "WorkStealingDeque stores trivially copyable items");
+
+private:
+    struct Array {
+        const int64_t capacity;
+        const int64_t mask;
+        std::unique_ptr<std::atomic<T>[]> items;
+
+        explicit Array(int64_t capacity)
+                : capacity(capacity), mask(capacity - 1), items(new std::atomic<T>[capacity]) {}
+
+        T get(int64_t i) const noexcept {
+            return items[i & mask].load(std::memory_order_relaxed);
+        }
+
+        void put(int64_t i, T item) noexcept {
+            items[i & mask].store(item, std::memory_order_relaxed);
+        }
+
+        Array *grow(int64_t bottom, int64_t top) const {
+            auto *bigger = new Array(capacity * 2);
+            for (int64_t i = top; i < bottom; ++i) {
+                bigger->put(i, get(i));
+            }
+            return bigger;
+        }
+    };
+
+    alignas(CACHE_LINE_SIZE) std::atomic<int64_t> top{0};
+    alignas(CACHE_LINE_SIZE) std::atomic<int64_t> bottom{0};
+    std::atomic<Array *> array;
+    // 只由拥有者线程访问
+    std::vector<std::unique_ptr<Array>> retired;
+
+public:
+    explicit WorkStealingDeque(int64_t capacity = 256) {
+        int64_t rounded = 2;
+        while (rounded < capacity) {
+            rounded <<= 1;
+        }
+        retired.emplace_back(new Array(rounded));
+        array.store(retired.back().get(), std::memory_order_relaxed);
+    }
+
+    WorkStealingDeque(const WorkStealingDeque &) = delete;
+    WorkStealingDeque &operator=(const WorkStealingDeque &) = delete;
+
+    // Owner only.
+    void push(T item) {
+        int64_t b = bottom.load(std::memory_order_relaxed);
+        int64_t t = top.load(std::memory_order_acquire);
+        Array *a = array.load(std::memory_order_relaxed);
+        if (b - t > a->capacity - 1) {
+            a = a->grow(b, t);
+            retired.emplace_back(a);
+            array.store(a, std::memory_order_release);
+        }
+        a->put(b, item);
+        std::atomic_thread_fence(std::memory_order_release);
+        bottom.store(b + 1, std::memory_order_relaxed);
+    }
+
+    // Owner only. Returns T{} when the deque is empty.
+    T pop() {
+        int64_t b = bottom.load(std::memory_order_relaxed) - 1;
+        Array *a = array.load(std::memory_order_relaxed);
+        bottom.store(b, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        int64_t t = top.load(std::memory_order_relaxed);
+        if (t > b) {
+            bottom.store(b + 1, std::memory_order_relaxed);
+            return T{};
+        }
+        T item = a->get(b);
+        if (t == b) {
+            // 只剩最后一个元素，和窃取者竞争
+            if (!top.compare_exchange_strong(t, t + 1, std::memory_order_seq_cst, std::memory_order_relaxed)) {
+                item = T{};
+            }
+            bottom.store(b + 1, std::memory_order_relaxed);
+        }
+        return item;
+    }
+
+    // Any thread. Returns T{} when the deque is empty or another thief won the race.
+    T steal() {
+        int64_t t = top.load(std::memory_order_acquire);
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        int64_t b = bottom.load(std::memory_order_acquire);
+        if (t >= b) {
+            return T{};
+        }
+        Array *a = array.load(std::memory_order_acquire);
+        T item = a->get(t);
+        if (!top.compare_exchange_strong(t, t + 1, std::memory_order_seq_cst, std::memory_order_relaxed)) {
+            return T{};
+        }
+        return item;
+    }
+
+    // 近似值，仅用于判断是否值得去窃取
+    bool empty() const {
+        return bottom.load(std::memory_order_relaxed) <= top.load(std::memory_order_relaxed);
+    }
+};
+
+
+#endif //EVENTLOOPMANAGER_WORKSTEALINGDEQUE_H
@@ -0,0 +1,455 @@
+// 热路径微基准：队列后端、线程池、通道扇出、事件分发延迟和 JSON 序列化。
+// 每个基准输出一行 JSON（JSON Lines），便于保存后与基线比较：
+//   ./bench > results.jsonl
+//   ./bench --filter queue/ --quick
+// 字段：name、ops、seconds、ops_per_sec、ns_per_op、allocs_per_op，测延迟的基准另有 p50_ns/p99_ns/p999_ns/max_ns。
+// ops 为 0 时 ns_per_op 和 allocs_per_op 为 null（CSV 中为空）。
+
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <functional>
+#include <memory>
+#include <new>
+#include <optional>
+#include <string>
+#include <thread>
+#include <vector>
+#include "rapidjson/document.h"
+#include "rapidjson/stringbuffer.h"
+#include "rapidjson/writer.h"
+#include "Logger.h"
+#include "Manager.h"
+#include "Metrics.h"
+#include "SensorReading.h"
+#include "ThreadPool.h"
+#include "ThreadSafeBlockingQueue.h"
+#include "ThreadSafeConcurrentReadQueue.h"
+#include "ThreadSafeLockFreeQueue.h"
+#include "ThreadSafeSpscQueue.h"
+#include "ThreadSafeWritePriorityQueue.h"
+
+// 统计所有线程的堆分配次数，结果按操作数平均为 allocs_per_op。
+// 替换后的 operator new/delete 成对使用 malloc/free，GCC 内联后会误报不匹配
+#if defined(__GNUC__) && !defined(__clang__)
+#pragma GCC diagnostic ignored "-Wmismatched-new-delete"
+#endif
+
+static std::atomic<uint64_t> allocationCount{0};
+
+void *operator new(std::size_t size) {
+    allocationCount.fetch_add(1, std::memory_order_relaxed);
+    if (void *p = std::malloc(size ? size : 1)) {
+        return p;
+    }
+    throw std::bad_alloc();
+}
+
+void *operator new(std::size_t size, std::align_val_t alignment) {
+    allocationCount.fetch_add(1, std::memory_order_relaxed);
+    size_t align = static_cast<size_t>(alignment);
+    if (void *p = std::aligned_alloc(align, (size + align - 1) / align * align)) {
+        return p;
+    }
+    throw std::bad_alloc();
+}
+
+void operator delete(void *p) noexcept {
+    std::free(p);
+}
+
+void operator delete(void *p, std::size_t) noexcept {
+    std::free(p);
+}
+
+void operator delete(void *p, std::align_val_t) noexcept {
+    std::free(p);
+}
+
+void operator delete(void *p, std::size_t, std::align_val_t) noexcept {
+    std::free(p);
+}
+
+namespace {
+
+struct BenchOptions {
+    std::string filter;
+    // 各基准的操作数除以 scale，--quick 用于冒烟测试
+    uint64_t scale = 1;
+    bool csv = false;
+};
+
+BenchOptions options;
+
+uint64_t scaled(uint64_t ops) {
+    return std::max<uint64_t>(ops / options.scale, 1);
+}
+
+bool selected(const std::string &name) {
+    return options.filter.empty() || name.find(options.filter) != std::string::npos;
+}
+
+// 计时并统计分配次数；latency 非空时一并输出延迟分位数
+void report(const std::string &name, uint64_t ops, std::chrono::steady_clock::duration elapsed, uint64_t allocations,
+            const LatencyHistogram *latency = nullptr) {
+    double seconds = std::chrono::duration<double>(elapsed).count();
+    double opsPerSec = seconds > 0 ? static_cast<double>(ops) / seconds : 0;
+    // 没有完成任何操作时每操作的指标没有意义：JSON 输出 null，CSV 留空，避免 inf/nan
+    auto perOp = [&](double total, const char *format) -> std::string {
+        if (ops == 0) {
+            return options.csv ? "" : "null";
+        }
+        char text[32];
+        std::snprintf(text, sizeof(text), format, total / static_cast<double>(ops));
+        return text;
+    };
+    std::string nsPerOp = perOp(static_cast<double>(
+            std::chrono::duration_cast<std::chrono::nanoseconds>(elapsed).count()), "%.2f");
+    std::string allocsPerOp = perOp(static_cast<double>(allocations), "%.3f");
+    HistogramSnapshot snapshot;
+    if (latency) {
+        snapshot = latency->snapshot();
+    }
+    auto p = [&](double q) { return static_cast<unsigned long long>(snapshot.percentile(q)); };
+    if (options.csv) {
+        std::printf("%s,%llu,%.6f,%.1f,%s,%s,%llu,%llu,%llu,%llu\n", name.c_str(),
+                    static_cast<unsigned long long>(ops), seconds, opsPerSec, nsPerOp.c_str(), allocsPerOp.c_str(),
+                    p(0.5), p(0.99), p(0.999), static_cast<unsigned long long>(snapshot.max));
+    } else {
+        std::printf("{\"name\":\"%s\",\"ops\":%llu,\"seconds\":%.6f,\"ops_per_sec\":%.1f,\"ns_per_op\":%s,"
+                    "\"allocs_per_op\":%s", name.c_str(), static_cast<unsigned long long>(ops), seconds,
+                    opsPerSec, nsPerOp.c_str(), allocsPerOp.c_str());
+        if (latency) {
+            std::printf(",\"p50_ns\":%llu,\"p99_ns\":%llu,\"p999_ns\":%llu,\"max_ns\":%llu", p(0.5), p(0.99),
+                        p(0.999), static_cast<unsigned long long>(snapshot.max));
+        }
+        std::printf("}\n");
+    }
+    std::fflush(stdout);
+}
+
+// 运行 body 并报告；body 返回实际完成的操作数
+void measure(const std::string &name, const std::function<uint64_t()> &body,
+             const LatencyHistogram *latency = nullptr) {
+    uint64_t allocationsBefore = allocationCount.load(std::memory_order_relaxed);
+    auto start = std::chrono::steady_clock::now();
+    uint64_t ops = body();
+    auto elapsed = std::chrono::steady_clock::now() - start;
+    report(name, ops, elapsed, allocationCount.load(std::memory_order_relaxed) - allocationsBefore, latency);
+}
+
+void waitUntil(const std::atomic<uint64_t> &counter, uint64_t target) {
+    while (counter.load(std::memory_order_acquire) < target) {
+        std::this_thread::yield();
+    }
+}
+
+// ---------------------------------------------------------------- 队列
+
+// producers 个线程共写入 items 个元素，consumers 个线程用 waitAndPop 取完；每个消费者最后收到一个 -1 作为结束标记
+void queueBenchmark(const std::string &name, ThreadSafeQueueInterface<int64_t> &queue, size_t producers,
+                    size_t consumers, uint64_t items) {
+    std::string fullName = name + "/p" + std::to_string(producers) + "c" + std::to_string(consumers);
+    if (!selected(fullName)) {
+        return;
+    }
+    measure(fullName, [&] {
+        std::atomic<uint64_t> received{0};
+        std::vector<std::thread> threads;
+        for (size_t c = 0; c < consumers; ++c) {
+            threads.emplace_back([&] {
+                uint64_t count = 0;
+                while (queue.waitAndPop() >= 0) {
+                    ++count;
+                }
+                received.fetch_add(count, std::memory_order_relaxed);
+            });
+        }
+        std::vector<std::thread> writers;
+        for (size_t p = 0; p < producers; ++p) {
+            writers.emplace_back([&, p] {
+                for (uint64_t i = p; i < items; i += producers) {
+                    queue.push(static_cast<int64_t>(i));
+                }
+            });
+        }
+        for (auto &writer: writers) {
+            writer.join();
+        }
+        for (size_t c = 0; c < consumers; ++c) {
+            queue.push(-1);
+        }
+        for (auto &thread: threads) {
+            thread.join();
+        }
+        return received.load();
+    });
+}
+
+void runQueueBenchmarks() {
+    const uint64_t items = scaled(1000000);
+    const std::pair<size_t, size_t> shapes[] = {{1, 1}, {2, 2}, {4, 4}, {1, 4}, {4, 1}};
+    for (auto [producers, consumers]: shapes) {
+        ThreadSafeBlockingQueue<int64_t> blocking;
+        queueBenchmark("queue/blocking", blocking, producers, consumers, items);
+        ThreadSafeConcurrentReadQueue<int64_t> concurrentRead;
+        queueBenchmark("queue/concurrent_read", concurrentRead, producers, consumers, items);
+        ThreadSafeWritePriorityQueue<int64_t> writePriority;
+        queueBenchmark("queue/write_priority", writePriority, producers, consumers, items);
+        ThreadSafeLockFreeQueue<int64_t> lockFree(4096);
+        queueBenchmark("queue/lock_free", lockFree, producers, consumers, items);
+    }
+    ThreadSafeSpscQueue<int64_t> spsc(4096);
+    queueBenchmark("queue/spsc", spsc, 1, 1, items);
+}
+
+// ---------------------------------------------------------------- 线程池
+
+void runPoolBenchmarks() {
+    ThreadPool pool(4, ThreadPlacement{PinningStrategy::None, {}, "bench"});
+
+    // 外部线程连续 post 空任务，到全部执行完为止
+    if (selected("pool/post_throughput")) {
+        const uint64_t tasks = scaled(1000000);
+        measure("pool/post_throughput", [&] {
+            std::atomic<uint64_t> done{0};
+            for (uint64_t i = 0; i < tasks; ++i) {
+                pool.post([&done] { done.fetch_add(1, std::memory_order_release); });
+            }
+            waitUntil(done, tasks);
+            return tasks;
+        });
+    }
+
+    // enqueue 额外创建 packaged_task 和 future
+    if (selected("pool/enqueue_throughput")) {
+        const uint64_t tasks = scaled(200000);
+        measure("pool/enqueue_throughput", [&] {
+            std::vector<std::future<int>> futures;
+            futures.reserve(tasks);
+            for (uint64_t i = 0; i < tasks; ++i) {
+                futures.push_back(pool.enqueue([] { return 1; }));
+            }
+            uint64_t sum = 0;
+            for (auto &future: futures) {
+                sum += static_cast<uint64_t>(future.get());
+            }
+            return sum;
+        });
+    }
+
+    // 工作线程内部递归提交（走本地队列和窃取）
+    if (selected("pool/local_fanout")) {
+        const uint64_t tasks = scaled(1000000);
+        measure("pool/local_fanout", [&] {
+            std::atomic<uint64_t> done{0};
+            std::function<void(uint64_t)> spawn = [&](uint64_t count) {
+                if (count > 1) {
+                    uint64_t half = count / 2;
+                    pool.post([&spawn, half] { spawn(half); });
+                    pool.post([&spawn, rest = count - half] { spawn(rest); });
+                } else {
+                    done.fetch_add(1, std::memory_order_release);
+                }
+            };
+            pool.post([&spawn, tasks] { spawn(tasks); });
+            waitUntil(done, tasks);
+            return tasks;
+        });
+    }
+
+    // 单个任务从 post 到开始执行的延迟：逐个提交，上一个执行完再提交下一个，包含唤醒睡眠线程的开销
+    if (selected("pool/post_latency")) {
+        const uint64_t rounds = scaled(20000);
+        LatencyHistogram latency;
+        measure("pool/post_latency", [&] {
+            std::atomic<uint64_t> done{0};
+            for (uint64_t i = 0; i < rounds; ++i) {
+                int64_t posted = metricsNow();
+                pool.post([&, posted] {
+                    latency.record(static_cast<uint64_t>(metricsNow() - posted));
+                    done.fetch_add(1, std::memory_order_release);
+                });
+                waitUntil(done, i + 1);
+            }
+            return rounds;
+        }, &latency);
+    }
+}
+
+// ---------------------------------------------------------------- Manager
+
+class BenchEvent : public TypedEvent<BenchEvent> {
+public:
+    int64_t publishedNanos = 0;
+};
+
+void runManagerBenchmarks() {
+    Manager &manager = Manager::getInstance();
+
+    // publishToChannel 扇出到 subscribers 个按值订阅的监听器，计到所有监听器都收到为止
+    for (size_t subscribers: {1, 4, 16}) {
+        std::string name = "manager/channel_fanout/" + std::to_string(subscribers);
+        if (!selected(name)) {
+            continue;
+        }
+        const uint64_t messages = scaled(200000);
+        std::string channelName = "BenchFanout" + std::to_string(subscribers);
+        ChannelConfig config;
+        config.capacity = 4096;
+        manager.createChannel<SensorReading>(channelName, config);
+        std::atomic<uint64_t> received{0};
+        for (size_t i = 0; i < subscribers; ++i) {
+            manager.subscribeChannel<SensorReading>(channelName, [&received](SensorReading) {
+                received.fetch_add(1, std::memory_order_release);
+            });
+        }
+        SensorReading reading;
+        reading.sensor = SensorRegistry::intern("bench");
+        measure(name, [&] {
+            for (uint64_t i = 0; i < messages; ++i) {
+                reading.id = static_cast<uint32_t>(i);
+                manager.publishToChannel(channelName, reading);
+            }
+            waitUntil(received, messages * subscribers);
+            return messages;
+        });
+    }
+
+    bool eventsSelected = selected("manager/event_throughput") || selected("manager/event_latency");
+    if (!eventsSelected) {
+        return;
+    }
+    std::thread loop([&manager] { manager.run(std::chrono::hours(24)); });
+    EventTypeId eventType = manager.eventType("BenchEvent");
+    std::atomic<uint64_t> handled{0};
+    LatencyHistogram latency;
+    // 只有延迟基准的事件带发布时间
+    ListenerId listener = manager.subscribeEvent(eventType, [&](std::shared_ptr<Event> event) {
+        auto benchEvent = eventCast<BenchEvent>(event);
+        if (benchEvent && benchEvent->publishedNanos != 0) {
+            latency.record(static_cast<uint64_t>(metricsNow() - benchEvent->publishedNanos));
+        }
+        handled.fetch_add(1, std::memory_order_release);
+    });
+
+    // 连续发布，事件循环成批取走
+    if (selected("manager/event_throughput")) {
+        const uint64_t events = scaled(500000);
+        uint64_t base = handled.load();
+        measure("manager/event_throughput", [&] {
+            for (uint64_t i = 0; i < events; ++i) {
+                manager.publishEvent(eventType, std::make_shared<BenchEvent>());
+            }
+            waitUntil(handled, base + events);
+            return events;
+        });
+    }
+
+    // 逐个发布，上一个处理完再发布下一个：publishEvent 到监听器开始执行的延迟
+    if (selected("manager/event_latency")) {
+        const uint64_t rounds = scaled(20000);
+        uint64_t base = handled.load();
+        measure("manager/event_latency", [&] {
+            for (uint64_t i = 0; i < rounds; ++i) {
+                auto event = std::make_shared<BenchEvent>();
+                event->publishedNanos = metricsNow();
+                manager.publishEvent(eventType, std::move(event));
+                waitUntil(handled, base + i + 1);
+            }
+            return rounds;
+        }, &latency);
+    }
+
+    manager.unsubscribeEvent(eventType, listener);
+    manager.stop();
+    loop.join();
+}
+
+// ---------------------------------------------------------------- JSON
+
+void runJsonBenchmarks() {
+    SensorReading reading;
+    reading.sensor = SensorRegistry::intern("sensor-bench");
+    reading.temperature = 21.5f;
+    reading.humidity = 40.25f;
+    reading.co2Concentration = 415.0f;
+    reading.latitude = 31.2304;
+    reading.longitude = 121.4737;
+    const uint64_t iterations = scaled(1000000);
+
+    // 当前的出口路径：直接用复用的 Writer 输出，不构造 DOM
+    if (selected("json/sensor_reading_writer")) {
+        measure("json/sensor_reading_writer", [&] {
+            size_t bytes = 0;
+            for (uint64_t i = 0; i < iterations; ++i) {
+                reading.id = static_cast<uint32_t>(i);
+                bytes += toJson(reading).size();
+            }
+            return bytes != 0 ? iterations : 0;
+        });
+    }
+
+    // 作为对照：原来 Producer 的做法，每条读数构造一个 Document 再用新的 StringBuffer 序列化
+    if (selected("json/sensor_reading_dom")) {
+        measure("json/sensor_reading_dom", [&] {
+            size_t bytes = 0;
+            for (uint64_t i = 0; i < iterations; ++i) {
+                rapidjson::Document doc;
+                doc.SetObject();
+                auto &allocator = doc.GetAllocator();
+                doc.AddMember("id", static_cast<int>(i), allocator);
+                rapidjson::Value nameValue;
+                nameValue.SetString(reading.sensorName().c_str(), allocator);
+                doc.AddMember("name", nameValue, allocator);
+                doc.AddMember("temperature", reading.temperature, allocator);
+                doc.AddMember("humidity", reading.humidity, allocator);
+                doc.AddMember("co2Concentration", reading.co2Concentration, allocator);
+                doc.AddMember("latitude", reading.latitude, allocator);
+                doc.AddMember("longitude", reading.longitude, allocator);
+                rapidjson::StringBuffer buffer;
+                rapidjson::Writer<rapidjson::StringBuffer> writer(buffer);
+                doc.Accept(writer);
+                bytes += buffer.GetSize();
+            }
+            return bytes != 0 ? iterations : 0;
+        });
+    }
+}
+
+void usage(const char *program) {
+    std::fprintf(stderr, "usage: %s [--filter <substring>] [--quick] [--scale <n>] [--csv]\n", program);
+}
+
+} // namespace
+
+int main(int argc, char **argv) {
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+        if (arg == "--filter" && i + 1 < argc) {
+            options.filter = argv[++i];
+        } else if (arg == "--quick") {
+            options.scale = 100;
+        } else if (arg == "--scale" && i + 1 < argc) {
+            options.scale = std::max<uint64_t>(std::strtoull(argv[++i], nullptr, 10), 1);
+        } else if (arg == "--csv") {
+            options.csv = true;
+        } else {
+            usage(argv[0]);
+            return 2;
+        }
+    }
+    // 结果写到 stdout，日志不能混在里面
+    Logger::setLevel(LogLevel::Off);
+    if (options.csv) {
+        std::printf("name,ops,seconds,ops_per_sec,ns_per_op,allocs_per_op,p50_ns,p99_ns,p999_ns,max_ns\n");
+    }
+
+    runQueueBenchmarks();
+    runPoolBenchmarks();
+    runManagerBenchmarks();
+    runJsonBenchmarks();
+    return 0;
+}
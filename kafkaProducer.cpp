@@ -2,85 +2,316 @@
 #include <fstream>
 #include <sstream>
 #include <iostream>
+#include "Logger.h"
 
-KafkaProducer::KafkaProducer(const std::string& configFile, const std::string& topicStr)
-        : producer(nullptr), topic(nullptr), topicStr(topicStr) {
+KafkaProducer::KafkaProducer(const std::string& configFile, const std::string& topicStr,
+                             const KafkaProducerOptions& options)
+        : options(options), producer(nullptr), topicStr(topicStr),
+          deliveryLatency(MetricsRegistry::instance().histogram(
+                  "kafka_delivery_latency_seconds", MetricsRegistry::label("topic", topicStr),
+                  "Time from produce to the delivery report")) {
     std::string errstr;
     RdKafka::Conf* conf = RdKafka::Conf::create(RdKafka::Conf::CONF_GLOBAL);
-    std::ifstream configFileStream(configFile);
-    std::string line;
 
-    std::cout << "Reading Kafka configuration from file: " << configFile << std::endl;
-    if (!configFileStream.is_open()) {
-        std::cerr << "Failed to open Kafka configuration file: " << configFile << std::endl;
-        exit(1);
-    }
+    if (!configFile.empty() || options.mockBrokers <= 0) {
+        std::ifstream configFileStream(configFile);
+        std::string line;
 
-    while (getline(configFileStream, line)) {
-        std::istringstream lineStream(line);
-        std::string key, val;
-        if (getline(lineStream, key, '=') && getline(lineStream, val)) {
-            std::cout << "Setting Kafka configuration: " << key << " = " << val << std::endl;
-            if (conf->set(key, val, errstr) != RdKafka::Conf::CONF_OK) {
-                std::cerr << "Failed to set Kafka configuration: " << errstr << std::endl;
-                exit(1);
+        LOG_INFO("Reading Kafka configuration from file: ", configFile);
+        if (!configFileStream.is_open()) {
+            std::cerr << "Failed to open Kafka configuration file: " << configFile << std::endl;
+            exit(1);
+        }
+
+        while (getline(configFileStream, line)) {
+            std::istringstream lineStream(line);
+            std::string key, val;
+            if (getline(lineStream, key, '=') && getline(lineStream, val)) {
+                LOG_INFO("Setting Kafka configuration: ", key, " = ", val);
+                if (conf->set(key, val, errstr) != RdKafka::Conf::CONF_OK) {
+                    std::cerr << "Failed to set Kafka configuration: " << errstr << std::endl;
+                    exit(1);
+                }
             }
         }
     }
 
+    if (options.mockBrokers > 0
+        && conf->set("test.mock.num.brokers", std::to_string(options.mockBrokers), errstr) != RdKafka::Conf::CONF_OK) {
+        std::cerr << "Failed to enable Kafka mock cluster: " << errstr << std::endl;
+        exit(1);
+    }
+
+    // 投递报告在轮询线程上回调
+    if (conf->set("dr_cb", &deliveryReportCallback, errstr) != RdKafka::Conf::CONF_OK) {
+        std::cerr << "Failed to set Kafka delivery report callback: " << errstr << std::endl;
+        exit(1);
+    }
+
     producer = RdKafka::Producer::create(conf, errstr);
     if (!producer) {
         std::cerr << "Failed to create producer: " << errstr << std::endl;
         exit(1);
     }
 
-    RdKafka::Conf* topicConf = RdKafka::Conf::create(RdKafka::Conf::CONF_TOPIC);
-    topic = RdKafka::Topic::create(producer, topicStr, topicConf, errstr);
-    if (!topic) {
-        std::cerr << "Failed to create topic: " << errstr << std::endl;
+    // 默认主题在构造时创建，配置错误时尽早失败
+    if (!topicHandle(topicStr)) {
         exit(1);
     }
 
     delete conf;
-    delete topicConf;
+
+    registerMetrics(MetricsRegistry::label("topic", topicStr));
+    poller = std::thread(&KafkaProducer::pollLoop, this);
+}
+
+void KafkaProducer::registerMetrics(const std::string& labels) {
+    MetricsRegistry& registry = MetricsRegistry::instance();
+    auto counter = [](const std::atomic<uint64_t>& count) {
+        return [&count] { return static_cast<double>(count.load(std::memory_order_relaxed)); };
+    };
+    metrics.push_back(registry.observe("kafka_produced_total", labels, MetricType::Counter, counter(producedCount),
+                                       "Messages handed to librdkafka"));
+    metrics.push_back(registry.observe("kafka_delivered_total", labels, MetricType::Counter, counter(deliveredCount),
+                                       "Messages acknowledged by the broker"));
+    metrics.push_back(registry.observe("kafka_failed_total", labels, MetricType::Counter, counter(failedCount),
+                                       "Messages whose delivery report carried an error"));
+    metrics.push_back(registry.observe("kafka_rejected_total", labels, MetricType::Counter, counter(rejectedCount),
+                                       "Messages never handed to librdkafka"));
+    metrics.push_back(registry.observe("kafka_in_flight", labels, MetricType::Gauge, [this] {
+        return static_cast<double>(inFlight.load(std::memory_order_relaxed));
+    }, "Messages produced but not yet reported"));
 }
 
 KafkaProducer::~KafkaProducer() {
-    // 确保所有排队的消息都被发送完毕
-    producer->flush(50000); // 参数是等待的毫秒数，这里假设等待最长5秒
+    // 轮询线程还在运行时等待在途消息收到投递报告，最长 options.closeTimeout
+    if (!flush(options.closeTimeout)) {
+        LOG_WARN("Kafka producer closing with ", inFlight.load(), " undelivered messages after ",
+                 options.closeTimeout.count(), "ms, purging");
+    }
+
+    polling.store(false, std::memory_order_release);
+    if (poller.joinable()) {
+        poller.join();
+    }
 
-    if (topic) {
-        delete topic; // 删除 topic 对象
-        topic = nullptr; // 避免野指针
+    // 超时仍未投递的消息：清除本地队列和在途请求，librdkafka 为每条消息产生一个失败的投递报告，
+    // 由下面的 flush 在当前线程上回调，释放它们的 opaque
+    if (inFlight.load(std::memory_order_acquire) != 0) {
+        producer->purge(RdKafka::Producer::PURGE_QUEUE | RdKafka::Producer::PURGE_INFLIGHT);
+        producer->flush(static_cast<int>(options.pollInterval.count()));
+    }
+    if (inFlight.load(std::memory_order_acquire) != 0) {
+        LOG_ERROR("Kafka producer destroyed with ", inFlight.load(), " messages still unreported");
     }
 
+    for (auto& [name, topic]: topics) {
+        delete topic;
+    }
+    topics.clear();
+
     if (producer) {
         delete producer; // 删除 producer 对象
         producer = nullptr; // 避免野指针
     }
 }
 
-void KafkaProducer::produce(const std::string& message) {
-    RdKafka::ErrorCode resp;
+bool KafkaProducer::produce(const std::string& message) {
+    return produce(std::make_shared<const std::string>(message));
+}
+
+bool KafkaProducer::produce(std::string&& message) {
+    return produce(std::make_shared<const std::string>(std::move(message)));
+}
+
+bool KafkaProducer::produce(std::shared_ptr<const std::string> message) {
+    return produce(topicStr, std::string(), std::move(message));
+}
+
+bool KafkaProducer::produce(const std::string& topicName, const std::string& key,
+                            std::shared_ptr<const std::string> message) {
+    auto* delivery = new Delivery{std::move(message), std::chrono::steady_clock::now()};
+    const std::string& payload = *delivery->payload;
+    // 不带 RK_MSG_COPY / RK_MSG_FREE：librdkafka 直接引用 payload，缓冲区由 Delivery 持有到投递报告
+    if (!enqueue(topicName, key, payload.data(), payload.size(), 0, delivery)) {
+        delete delivery;
+        return false;
+    }
+    return true;
+}
+
+bool KafkaProducer::produce(const std::string& topicName, const std::string& key, std::string_view message) {
+    auto enqueued = std::chrono::duration_cast<std::chrono::nanoseconds>(
+            std::chrono::steady_clock::now().time_since_epoch()).count();
+    void* opaque = reinterpret_cast<void*>((static_cast<uintptr_t>(enqueued) << 1) | 1);
+    return enqueue(topicName, key, message.data(), message.size(), RdKafka::Producer::RK_MSG_COPY, opaque);
+}
+
+bool KafkaProducer::enqueue(const std::string& topicName, const std::string& key, const char* data, size_t size,
+                            int flags, void* opaque) {
+    RdKafka::Topic* topic = topicHandle(topicName);
+    if (!topic) {
+        rejectedCount.fetch_add(1, std::memory_order_relaxed);
+        return false;
+    }
+
+    auto deadline = std::chrono::steady_clock::now() + options.enqueueTimeout;
+    if (!waitForInFlightSlot(deadline)) {
+        rejectedCount.fetch_add(1, std::memory_order_relaxed);
+        return false;
+    }
+
+    while (true) {
+        RdKafka::ErrorCode resp = producer->produce(
+                topic,                             // topic 对象
+                RdKafka::Topic::PARTITION_UA,      // 由分区器按键选择分区
+                flags,
+                const_cast<char*>(data), size,     // 消息内容和长度
+                key.empty() ? nullptr : &key,      // 同一个键的消息落在同一个分区上
+                opaque);                           // 投递报告中取回
+        if (resp == RdKafka::ERR_NO_ERROR) {
+            producedCount.fetch_add(1, std::memory_order_relaxed);
+            return true;
+        }
+        // 本地队列满：等轮询线程处理投递报告腾出空间后重试
+        if (resp == RdKafka::ERR__QUEUE_FULL && std::chrono::steady_clock::now() < deadline) {
+            queueFullRetryCount.fetch_add(1, std::memory_order_relaxed);
+            std::unique_lock<std::mutex> lock(inFlightMutex);
+            inFlightCond.wait_for(lock, std::chrono::milliseconds(10));
+            continue;
+        }
+        LOG_ERROR("Produce failed: ", RdKafka::err2str(resp));
+        {
+            std::lock_guard<std::mutex> lock(inFlightMutex);
+            inFlight.fetch_sub(1, std::memory_order_acq_rel);
+        }
+        inFlightCond.notify_all();
+        rejectedCount.fetch_add(1, std::memory_order_relaxed);
+        return false;
+    }
+}
+
+bool KafkaProducer::flush(std::chrono::milliseconds timeout) {
+    auto deadline = std::chrono::steady_clock::now() + timeout;
+    std::unique_lock<std::mutex> lock(inFlightMutex);
+    return inFlightCond.wait_until(lock, deadline, [this] {
+        return inFlight.load(std::memory_order_acquire) == 0;
+    });
+}
+
+KafkaDeliveryStats KafkaProducer::stats() const {
+    KafkaDeliveryStats snapshot;
+    snapshot.produced = producedCount.load(std::memory_order_relaxed);
+    snapshot.delivered = deliveredCount.load(std::memory_order_relaxed);
+    snapshot.failed = failedCount.load(std::memory_order_relaxed);
+    snapshot.rejected = rejectedCount.load(std::memory_order_relaxed);
+    snapshot.queueFullRetries = queueFullRetryCount.load(std::memory_order_relaxed);
+    snapshot.inFlight = inFlight.load(std::memory_order_relaxed);
+    snapshot.latencyTotal = std::chrono::nanoseconds(latencyTotalNanos.load(std::memory_order_relaxed));
+    snapshot.latencyMax = std::chrono::nanoseconds(latencyMaxNanos.load(std::memory_order_relaxed));
+    return snapshot;
+}
+
+RdKafka::Topic* KafkaProducer::topicHandle(const std::string& topicName) {
+    {
+        std::shared_lock<std::shared_mutex> lock(topicsMutex);
+        auto it = topics.find(topicName);
+        if (it != topics.end()) {
+            return it->second;
+        }
+    }
+    std::unique_lock<std::shared_mutex> lock(topicsMutex);
+    auto it = topics.find(topicName);
+    if (it != topics.end()) {
+        return it->second;
+    }
+
     std::string errstr;
+    std::unique_ptr<RdKafka::Conf> topicConf(RdKafka::Conf::create(RdKafka::Conf::CONF_TOPIC));
+    RdKafka::Conf::ConfResult result = options.partitioner
+                                       ? topicConf->set("partitioner_cb", &partitionerCallback, errstr)
+                                       : topicConf->set("partitioner", options.partitionerName, errstr);
+    if (result != RdKafka::Conf::CONF_OK) {
+        LOG_ERROR("Failed to set Kafka partitioner for topic ", topicName, ": ", errstr);
+        return nullptr;
+    }
+    RdKafka::Topic* topic = RdKafka::Topic::create(producer, topicName, topicConf.get(), errstr);
+    if (!topic) {
+        LOG_ERROR("Failed to create topic: ", errstr);
+        return nullptr;
+    }
+    topics.emplace(topicName, topic);
+    return topic;
+}
+
+int32_t KafkaProducer::PartitionerCallback::partitioner_cb(const RdKafka::Topic* topic, const std::string* key,
+                                                           int32_t partitionCount, void* msgOpaque) {
+    (void) msgOpaque;
+    int32_t partition = partitioner(topic->name(), key ? std::string_view(*key) : std::string_view(),
+                                    partitionCount);
+    // 超出范围的返回值按分区数取模，librdkafka 要求返回一个存在的分区
+    return ((partition % partitionCount) + partitionCount) % partitionCount;
+}
+
+// 在途消息未达上限时占用一个名额
+bool KafkaProducer::waitForInFlightSlot(std::chrono::steady_clock::time_point deadline) {
+    size_t current = inFlight.load(std::memory_order_relaxed);
+    while (true) {
+        if (current < options.maxInFlight) {
+            if (inFlight.compare_exchange_weak(current, current + 1, std::memory_order_acq_rel)) {
+                return true;
+            }
+            continue;
+        }
+        std::unique_lock<std::mutex> lock(inFlightMutex);
+        if (!inFlightCond.wait_until(lock, deadline, [&] {
+            current = inFlight.load(std::memory_order_acquire);
+            return current < options.maxInFlight;
+        })) {
+            return false;
+        }
+    }
+}
 
-    // 使用 librdkafka 发送消息。这里假设 topicStr 和 producer 已在构造函数中正确初始化
-    resp = producer->produce(
-            topic,                             // topic 对象
-            RdKafka::Topic::PARTITION_UA,      // 使用未分配的分区
-            RdKafka::Producer::RK_MSG_COPY,    // 消息内容需要被 librdkafka 复制
-            const_cast<char *>(message.c_str()), message.size(), // 消息内容和长度
-            NULL,                              // 没有 key
-            NULL);                             // Opaque value (用户提供的数据，回调时返回)
-
-    if (resp != RdKafka::ERR_NO_ERROR) {
-        std::cerr << "Produce failed: " << RdKafka::err2str(resp) << std::endl;
+void KafkaProducer::DeliveryReportCallback::dr_cb(RdKafka::Message& message) {
+    owner.onDelivered(message);
+}
+
+void KafkaProducer::onDelivered(RdKafka::Message& message) {
+    if (message.err() == RdKafka::ERR_NO_ERROR) {
+        deliveredCount.fetch_add(1, std::memory_order_relaxed);
+    } else {
+        failedCount.fetch_add(1, std::memory_order_relaxed);
+        // 析构时清除的消息只在析构函数里汇总一次
+        if (message.err() != RdKafka::ERR__PURGE_QUEUE && message.err() != RdKafka::ERR__PURGE_INFLIGHT) {
+            LOG_ERROR("Kafka delivery failed: ", message.errstr());
+        }
+    }
+    auto opaque = reinterpret_cast<uintptr_t>(message.msg_opaque());
+    std::chrono::steady_clock::time_point enqueued;
+    if (opaque & 1) {
+        enqueued = std::chrono::steady_clock::time_point(std::chrono::duration_cast<std::chrono::steady_clock::duration>(
+                std::chrono::nanoseconds(static_cast<int64_t>(opaque >> 1))));
     } else {
-         std::cout << "Message produced: " << message << std::endl;
+        std::unique_ptr<Delivery> delivery(static_cast<Delivery*>(message.msg_opaque()));
+        enqueued = delivery->enqueued;
+    }
+    int64_t latency = std::chrono::duration_cast<std::chrono::nanoseconds>(
+            std::chrono::steady_clock::now() - enqueued).count();
+    latencyTotalNanos.fetch_add(latency, std::memory_order_relaxed);
+    deliveryLatency.record(std::chrono::nanoseconds(latency));
+    int64_t max = latencyMaxNanos.load(std::memory_order_relaxed);
+    while (latency > max && !latencyMaxNanos.compare_exchange_weak(max, latency, std::memory_order_relaxed)) {}
+    {
+        // 在锁内减少计数，等待者不会在检查条件和睡眠之间错过通知
+        std::lock_guard<std::mutex> lock(inFlightMutex);
+        inFlight.fetch_sub(1, std::memory_order_acq_rel);
     }
+    inFlightCond.notify_all();
+}
 
-    // librdkafka 基于异步的，调用 poll 来触发回调（如消息发送成功或失败的回调）
-    // 这里 poll 0 表示立即返回，不等待
-    // 如果需要等待回调，可以调用 producer->poll(1000) 等待 1000 毫秒
-    producer->poll(0);
+void KafkaProducer::pollLoop() {
+    while (polling.load(std::memory_order_acquire)) {
+        producer->poll(static_cast<int>(options.pollInterval.count()));
+    }
 }
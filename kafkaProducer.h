@@ -2,19 +2,168 @@
 #define KAFKAPRODUCER_H
 
 #include <librdkafka/rdkafkacpp.h>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <shared_mutex>
 #include <string>
+#include <string_view>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+#include "Metrics.h"
 
+// 自定义分区函数：按主题名、消息键（没有键时为空）和分区数返回分区编号，超出范围时按分区数取模。
+// 在 librdkafka 的内部线程上调用，不能阻塞
+using KafkaPartitioner = std::function<int32_t(std::string_view topic, std::string_view key, int32_t partitionCount)>;
+
+struct KafkaProducerOptions {
+    // 已交给 librdkafka 但尚未收到投递报告的消息上限，达到上限时 produce 等待
+    size_t maxInFlight = 100000;
+    // 在途消息达到上限或 librdkafka 本地队列满（ERR__QUEUE_FULL）时最多等待多久，超时后放弃这条消息
+    std::chrono::milliseconds enqueueTimeout{1000};
+    // 轮询线程每次 poll 的超时
+    std::chrono::milliseconds pollInterval{100};
+    // 析构时等待在途消息收到投递报告的最长时间，超时后剩下的消息被清除（计入 failed）
+    std::chrono::milliseconds closeTimeout{5000};
+    // 大于 0 时使用 librdkafka 内置的 mock 集群（test.mock.num.brokers），不需要真实的 broker
+    int mockBrokers = 0;
+    // librdkafka 内置的分区器（主题配置 partitioner）。murmur2_random 与 Java 客户端一致：
+    // 同一个键总在同一个分区上，没有键的消息随机分布
+    std::string partitionerName = "murmur2_random";
+    // 设置后代替 partitionerName
+    KafkaPartitioner partitioner;
+};
+
+// 投递统计的快照，延迟从 produce 入队到收到投递报告
+struct KafkaDeliveryStats {
+    uint64_t produced = 0;         // 成功交给 librdkafka 的消息
+    uint64_t delivered = 0;        // 投递报告为成功
+    uint64_t failed = 0;           // 投递报告为失败（librdkafka 内部重试之后仍失败）
+    uint64_t rejected = 0;         // 等待超时或 produce 直接失败，没有交给 librdkafka
+    uint64_t queueFullRetries = 0; // 因本地队列满而重试的次数
+    uint64_t inFlight = 0;
+    std::chrono::nanoseconds latencyTotal{0};
+    std::chrono::nanoseconds latencyMax{0};
+};
+
+/*
+ * 异步 Kafka 生产者。
+ *  - 独立的轮询线程调用 poll()，投递报告回调在轮询线程上执行，produce 的调用方不再被 poll 拖慢；
+ *  - 消息内容不复制：调用方交出的缓冲区（移动进来的 string 或共享的 shared_ptr）随消息的 opaque 一起
+ *    交给 librdkafka，收到投递报告时释放；
+ *  - 在途消息有上限，本地队列满时等待投递报告腾出空间后重试，超时则放弃并计入 rejected；
+ *  - 每条消息的投递延迟计入 stats()。
+ * 配置文件为空、且 options.mockBrokers 大于 0 时，不读取配置文件，直接连接 mock 集群。
+ *
+ * 可以发送到任意主题：RdKafka::Topic 句柄在第一次使用时创建并缓存，之后只是一次共享锁下的查找。
+ * 带键的消息由分区器选择分区，同一个键（例如传感器名）的消息保持在同一个分区上、按发送顺序投递。
+ */
 class KafkaProducer {
 public:
     // 构造函数现在接收配置文件路径和主题名称
-    KafkaProducer(const std::string& configFile, const std::string& topicStr);
+    KafkaProducer(const std::string& configFile, const std::string& topicStr,
+                  const KafkaProducerOptions& options = KafkaProducerOptions{});
     ~KafkaProducer();
-    void produce(const std::string& message);
+
+    KafkaProducer(const KafkaProducer&) = delete;
+    KafkaProducer& operator=(const KafkaProducer&) = delete;
+
+    // 返回 false 表示消息没有交给 librdkafka（等待超时或 produce 失败）
+    bool produce(const std::string& message);
+
+    bool produce(std::string&& message);
+
+    // 与其他持有者共享同一份数据，不复制
+    bool produce(std::shared_ptr<const std::string> message);
+
+    // 发送到指定主题，key 为空表示没有键
+    bool produce(const std::string& topicName, const std::string& key, std::shared_ptr<const std::string> message);
+
+    // 由 librdkafka 复制消息内容（RK_MSG_COPY），调用返回后 message 的缓冲区即可复用。
+    // 适合序列化到线程本地缓冲区的消息：这一侧不分配内存，librdkafka 把消息头和内容放在同一次分配里
+    bool produce(const std::string& topicName, const std::string& key, std::string_view message);
+
+    // 等待在途消息全部收到投递报告，超时返回 false
+    bool flush(std::chrono::milliseconds timeout);
+
+    KafkaDeliveryStats stats() const;
 
 private:
+    // 随消息交给 librdkafka 的 opaque，投递报告回调中释放。
+    // 复制模式的消息不需要持有缓冲区，opaque 直接保存入队时间：(纳秒 << 1) | 1，与对齐的 Delivery 指针区分
+    struct Delivery {
+        std::shared_ptr<const std::string> payload;
+        std::chrono::steady_clock::time_point enqueued;
+    };
+
+    class DeliveryReportCallback : public RdKafka::DeliveryReportCb {
+    public:
+        explicit DeliveryReportCallback(KafkaProducer& owner) : owner(owner) {}
+
+        void dr_cb(RdKafka::Message& message) override;
+
+    private:
+        KafkaProducer& owner;
+    };
+
+    class PartitionerCallback : public RdKafka::PartitionerCb {
+    public:
+        explicit PartitionerCallback(const KafkaPartitioner& partitioner) : partitioner(partitioner) {}
+
+        int32_t partitioner_cb(const RdKafka::Topic* topic, const std::string* key, int32_t partitionCount,
+                               void* msgOpaque) override;
+
+    private:
+        const KafkaPartitioner& partitioner;
+    };
+
+    // 主题句柄，第一次使用时创建
+    RdKafka::Topic* topicHandle(const std::string& topicName);
+
+    // 占用在途名额并交给 librdkafka，本地队列满时等待重试；返回 false 时 opaque 仍归调用方所有
+    bool enqueue(const std::string& topicName, const std::string& key, const char* data, size_t size,
+                 int flags, void* opaque);
+
+    bool waitForInFlightSlot(std::chrono::steady_clock::time_point deadline);
+
+    void onDelivered(RdKafka::Message& message);
+
+    void pollLoop();
+
+    KafkaProducerOptions options;
+    DeliveryReportCallback deliveryReportCallback{*this};
+    PartitionerCallback partitionerCallback{options.partitioner};
     RdKafka::Producer* producer;
-    RdKafka::Topic* topic;
+    // 默认主题，不指定主题的 produce 发送到这里
     std::string topicStr;
+    std::shared_mutex topicsMutex;
+    std::unordered_map<std::string, RdKafka::Topic*> topics;
+
+    std::atomic<size_t> inFlight{0};
+    std::mutex inFlightMutex;
+    std::condition_variable inFlightCond;
+
+    std::atomic<uint64_t> producedCount{0};
+    std::atomic<uint64_t> deliveredCount{0};
+    std::atomic<uint64_t> failedCount{0};
+    std::atomic<uint64_t> rejectedCount{0};
+    std::atomic<uint64_t> queueFullRetryCount{0};
+    std::atomic<int64_t> latencyTotalNanos{0};
+    std::atomic<int64_t> latencyMaxNanos{0};
+
+    // 指标（标签 topic 为默认主题）：投递延迟直方图；计数器在采集时从上面的原子变量读取
+    LatencyHistogram& deliveryLatency;
+    std::vector<MetricsRegistration> metrics;
+
+    void registerMetrics(const std::string& labels);
+
+    std::atomic<bool> polling{true};
+    std::thread poller;
 };
 
 #endif // KAFKAPRODUCER_H
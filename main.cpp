@@ -5,8 +5,10 @@
 #include <memory>
 #include <thread>
 #include <librdkafka/rdkafkacpp.h>
+#include "Logger.h"
 #include "Manager.h"
 #include "Process.h"
+#include "ChannelKeys.h"
 #include "Producer.h"
 #include "Consumer.h"
 #include "StatusChangeEvent.h"
@@ -17,26 +19,48 @@
 // 状态改变者类
 class StatusChanger {
 public:
+    // 2 秒后在事件循环上发布状态变化事件，不占用单独的线程
     void changeStatus() {
-        Process process("StatusChanger");
-
-        // 模拟状态变化
-        std::this_thread::sleep_for(std::chrono::seconds(2));
-
-        // 发布状态变化事件开始收集数据
-        std::string status = "Receive";
-        std::shared_ptr<Event> event = std::make_shared<StatusChangeEvent>(status);
-        process.publishEvent("StatusChangeEvent", event);
+        Manager::getInstance().scheduleAfter(std::chrono::seconds(2), [] {
+            Process process("StatusChanger");
+
+            // 发布状态变化事件开始收集数据；控制事件以高优先级发布，不排在积压的事件后面
+            std::string status = "Receive";
+            std::shared_ptr<Event> event = std::make_shared<StatusChangeEvent>(status);
+            process.publishEvent("StatusChangeEvent", event, Priority::High);
+        });
     }
 };
 
 
 int main() {
+    // 运行期间每秒把指标快照（Prometheus 文本格式）写到工作目录下的 metrics.prom
+    ManagerConfig managerConfig;
+    managerConfig.metrics.file = "metrics.prom";
+    Manager::configure(managerConfig);
     Manager &manager = Manager::getInstance();
 
+    // 数据通道有界：Kafka 变慢时积压不会无限增长，生产者在高水位时自我节流
+    ChannelConfig dataChannelConfig;
+    dataChannelConfig.capacity = 1024;
+    dataChannelConfig.policy = BackpressurePolicy::Block;
+    dataChannelConfig.highWatermark = 768;
+    dataChannelConfig.lowWatermark = 256;
+    dataChannelConfig.onHighWater = [](const std::string &name, size_t depth) {
+        LOG_WARN(name, " reached high watermark, depth ", depth);
+    };
+    dataChannelConfig.onLowWater = [](const std::string &name, size_t depth) {
+        LOG_INFO(name, " back below low watermark, depth ", depth);
+    };
+    manager.createChannel(DATA_CHANNEL, dataChannelConfig);
+
     // 配置文件路径和Kafka主题
     std::filesystem::path cPath = std::filesystem::current_path();
     std::filesystem::path kafkaConfigPath = cPath.parent_path() / "configs/kafka_config.txt";
+    // 没有真实集群的配置时使用 librdkafka 内置的 mock 集群
+    if (!std::filesystem::exists(kafkaConfigPath)) {
+        kafkaConfigPath = cPath.parent_path() / "configs/kafka_mock_config.txt";
+    }
     std::filesystem::path sensorsConfigPath = cPath.parent_path() / "configs/sensors_config.json";
     std::string topic = "topic_0";
 
@@ -48,39 +72,46 @@ int main() {
     // 加载配置文件
     auto configs = ProducerConfig::loadFromJson(sensorsConfigPath);
 
-    // 生产者线程
-    std::vector<std::thread> producerThreads;
     // 为每个配置创建Producer实例
     std::vector<Producer> producers;
     for (const auto &config: configs) {
         producers.emplace_back(config.name, config.latitude, config.longitude);
     }
 
-    // 创建和启动生产者线程
+    // 启动生产者：读数由事件循环上的定时器驱动，生产者数量不再对应线程数量
     for (auto &producer: producers) {
-        producerThreads.emplace_back(&Producer::produceData, &producer);
+        producer.produceData();
     }
 
-    std::cout << "Main thread: " << std::this_thread::get_id() << " is running." << std::endl;
+    LOG_INFO("Main thread is running.");
 
-    // 创建和启动状态改变者和消费者线程
-    std::thread statusChangerThread(&StatusChanger::changeStatus, &statusChanger);
+    // 安排状态变化，创建和启动消费者线程
+    statusChanger.changeStatus();
     std::thread consumerThread(&Consumer::consumeData, &consumer);
     //std::thread consumerThread2(&Consumer::consumeData, &consumer2);
 
     // 运行 20 秒
     manager.run(std::chrono::seconds(10));
 
-    std::cout << "Main thread: " << std::this_thread::get_id() << " manager stopped." << std::endl;
+    LOG_INFO("Main thread: manager stopped.");
 
-    // 等待生产者、状态改变者和消费者线程结束
-    for (auto &t: producerThreads) {
-        t.join();
-    }
-    statusChangerThread.join();
+    // 分片上的定时器持有生产者的指针，生产者销毁之前先停止分片
+    manager.stopShards();
+
+    // 停止消费者：处理完收件箱中剩余的数据后协程退出，消费者线程随之结束
+    consumer.stop();
     consumerThread.join();
 
-    std::cout << "Main thread: " << std::this_thread::get_id() << " all threads joined." << std::endl;
+    LOG_INFO("Main thread: all threads joined.");
+
+    consumer.kafkaProducer.flush(std::chrono::seconds(5));
+    KafkaDeliveryStats kafkaStats = consumer.kafkaProducer.stats();
+    LOG_INFO("Kafka delivered ", kafkaStats.delivered, "/", kafkaStats.produced,
+             ", failed ", kafkaStats.failed, ", rejected ", kafkaStats.rejected,
+             ", max latency ", std::chrono::duration_cast<std::chrono::milliseconds>(kafkaStats.latencyMax).count(),
+             "ms");
+    // 日志由后台线程异步写出，退出前等它写完
+    Logger::instance().flush();
 
 
     /*
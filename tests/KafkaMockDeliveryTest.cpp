@@ -0,0 +1,79 @@
+// KafkaProducer 的异步投递路径跑在 librdkafka 内置的 mock 集群上（test.mock.num.brokers，不需要真实的 broker）：
+//  1. 各种 produce 重载发出的消息都由轮询线程收到投递报告，flush 之后 delivered == produced、没有失败；
+//  2. 析构时来不及投递的消息被清除，每个 opaque 都被释放：共享的消息缓冲区最后只剩测试自己持有的引用。
+// 运行：ctest -R KafkaMockDelivery，或直接执行 ./kafkaMockDeliveryTest，失败时返回非 0。
+
+#include <chrono>
+#include <cstdio>
+#include <memory>
+#include <string>
+#include "kafkaProducer.h"
+
+namespace {
+
+constexpr int MESSAGES = 1000;
+const std::string TOPIC = "mockDeliveryTest";
+
+bool check(bool condition, const char *what) {
+    if (!condition) {
+        std::printf("FAILED: %s\n", what);
+    }
+    return condition;
+}
+
+bool deliversEverything() {
+    KafkaProducerOptions options;
+    options.mockBrokers = 3;
+    KafkaProducer producer("", TOPIC, options);
+
+    auto shared = std::make_shared<const std::string>("shared payload");
+    for (int i = 0; i < MESSAGES; ++i) {
+        std::string key = "sensor" + std::to_string(i % 8);
+        std::string payload = "message " + std::to_string(i);
+        switch (i % 3) {
+            case 0:
+                producer.produce(TOPIC, key, std::string_view(payload));
+                break;
+            case 1:
+                producer.produce(TOPIC, key, shared);
+                break;
+            default:
+                producer.produce(std::move(payload));
+                break;
+        }
+    }
+
+    bool flushed = producer.flush(std::chrono::seconds(30));
+    KafkaDeliveryStats stats = producer.stats();
+    std::printf("delivery: produced %llu, delivered %llu, failed %llu, rejected %llu\n",
+                static_cast<unsigned long long>(stats.produced), static_cast<unsigned long long>(stats.delivered),
+                static_cast<unsigned long long>(stats.failed), static_cast<unsigned long long>(stats.rejected));
+    return check(flushed, "flush timed out")
+           && check(stats.produced == MESSAGES, "not every message was handed to librdkafka")
+           && check(stats.delivered == stats.produced, "delivered != produced")
+           && check(stats.failed == 0 && stats.inFlight == 0, "failed or still in flight after flush");
+}
+
+bool releasesUndeliveredOnDestroy() {
+    auto shared = std::make_shared<const std::string>("payload released on destroy");
+    {
+        KafkaProducerOptions options;
+        options.mockBrokers = 3;
+        // 不等待投递，析构时在途的消息全部走清除路径
+        options.closeTimeout = std::chrono::milliseconds(0);
+        KafkaProducer producer("", TOPIC, options);
+        for (int i = 0; i < MESSAGES; ++i) {
+            producer.produce(TOPIC, "", shared);
+        }
+    }
+    std::printf("destroy: shared payload use_count %ld\n", shared.use_count());
+    return check(shared.use_count() == 1, "undelivered messages leaked their opaque");
+}
+
+}
+
+int main() {
+    bool ok = deliversEverything();
+    ok = releasesUndeliveredOnDestroy() && ok;
+    return ok ? 0 : 1;
+}
@@ -0,0 +1,95 @@
+// ThreadPool::post 在稳定状态下不分配内存：替换全局 operator new 统计分配次数，
+// 预热节点池之后连续提交多轮任务，要求整个测量阶段的分配次数为 0。
+// 运行：ctest -R ThreadPoolAllocation，或直接执行 ./threadPoolAllocationTest，失败时返回非 0。
+
+#include <atomic>
+#include <cstdio>
+#include <cstdlib>
+#include <new>
+#include <thread>
+#include "ThreadPool.h"
+
+// 替换后的 operator new/delete 成对使用 malloc/free，GCC 内联后会误报不匹配
+#if defined(__GNUC__) && !defined(__clang__)
+#pragma GCC diagnostic ignored "-Wmismatched-new-delete"
+#endif
+
+static std::atomic<uint64_t> allocationCount{0};
+
+void *operator new(std::size_t size) {
+    allocationCount.fetch_add(1, std::memory_order_relaxed);
+    if (void *p = std::malloc(size ? size : 1)) {
+        return p;
+    }
+    throw std::bad_alloc();
+}
+
+void *operator new(std::size_t size, std::align_val_t alignment) {
+    allocationCount.fetch_add(1, std::memory_order_relaxed);
+    size_t align = static_cast<size_t>(alignment);
+    if (void *p = std::aligned_alloc(align, (size + align - 1) / align * align)) {
+        return p;
+    }
+    throw std::bad_alloc();
+}
+
+void operator delete(void *p) noexcept {
+    std::free(p);
+}
+
+void operator delete(void *p, std::size_t) noexcept {
+    std::free(p);
+}
+
+void operator delete(void *p, std::align_val_t) noexcept {
+    std::free(p);
+}
+
+void operator delete(void *p, std::size_t, std::align_val_t) noexcept {
+    std::free(p);
+}
+
+namespace {
+
+constexpr size_t THREADS = 4;
+// 测量阶段每轮同时在途的任务数
+constexpr uint64_t BATCH = 256;
+constexpr int ROUNDS = 200;
+
+// 提交 count 个任务并等到全部执行完。任务执行完到节点归还之间还有一小段时间，
+// 所以下一轮开始时每个工作线程最多还占着一个节点
+void postAndWait(ThreadPool &pool, uint64_t count) {
+    std::atomic<uint64_t> done{0};
+    for (uint64_t i = 0; i < count; ++i) {
+        pool.post([&done] { done.fetch_add(1, std::memory_order_release); });
+    }
+    while (done.load(std::memory_order_acquire) != count) {
+        std::this_thread::yield();
+    }
+}
+
+}
+
+int main() {
+    ThreadPool pool(THREADS);
+
+    // 预热：本线程的节点池里攒下两倍于测量阶段的节点，足够覆盖尚未归还的节点
+    for (int i = 0; i < 3; ++i) {
+        postAndWait(pool, 2 * BATCH);
+    }
+
+    uint64_t before = allocationCount.load(std::memory_order_relaxed);
+    for (int round = 0; round < ROUNDS; ++round) {
+        postAndWait(pool, BATCH);
+    }
+    uint64_t allocations = allocationCount.load(std::memory_order_relaxed) - before;
+
+    uint64_t posts = BATCH * ROUNDS;
+    std::printf("ThreadPool::post: %llu posts, %llu allocations\n", static_cast<unsigned long long>(posts),
+                static_cast<unsigned long long>(allocations));
+    if (allocations != 0) {
+        std::printf("FAILED: steady-state post() allocated\n");
+        return 1;
+    }
+    return 0;
+}